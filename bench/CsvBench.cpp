@@ -0,0 +1,135 @@
+// Compares ways of writing books.csv, in rows per second, each writing the
+// whole catalog to a file: the original writer (an ofstream with std::endl
+// after every row, so one flush per row), an ostringstream written once, and
+// BookCsv::format written once, as saveBooks does now. All three produce the
+// same bytes, which is checked.
+//
+// Usage: CsvBench [book count] [output directory]
+
+#include "BookCsv.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const int ROUNDS = 5; // The best round is reported.
+
+    std::vector<Book> makeBooks(size_t count)
+    {
+        const char *openings[] = {"A Brief History of ", "The Art of ", "How to ", "The Complete Guide to ", "Notes on "};
+        const char *subjects[] = {"Toasters", "Procrastination", "Meetings", "Cats", "Microwave Cooking", "Dad Jokes", "Zombies"};
+        std::mt19937 rng(42);
+        std::vector<Book> books(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            Book &book = books[i];
+            book.isbn = std::to_string(100000 + i);
+            book.title = std::string(openings[rng() % 5]) + subjects[rng() % 7] + " Volume " + std::to_string(rng() % 40 + 1);
+            book.author = "Author Number " + std::to_string(rng() % 500);
+            if (rng() % 5 == 0)
+            {
+                book.isCheckedOut = true;
+                book.borrowerUsername = "reader" + std::to_string(rng() % 50);
+                book.dueDate = 1700000000 + static_cast<std::time_t>(i);
+            }
+        }
+        return books;
+    }
+
+    // The writer saveBooks started from, plus the due-date column so the files match.
+    void writeWithEndl(const std::string &path, const std::vector<Book> &books)
+    {
+        std::ofstream output(path);
+        for (const auto &book : books)
+        {
+            output << book.isbn << "," << book.title << "," << book.author
+                   << "," << (book.isCheckedOut ? "1" : "0") << "," << book.borrowerUsername << ",";
+            if (book.isCheckedOut && book.dueDate != 0)
+                output << static_cast<long long>(book.dueDate);
+            output << std::endl;
+        }
+    }
+
+    void writeWithStringStream(const std::string &path, const std::vector<Book> &books)
+    {
+        std::ostringstream buffer;
+        for (const auto &book : books)
+        {
+            buffer << book.isbn << "," << book.title << "," << book.author
+                   << "," << (book.isCheckedOut ? "1" : "0") << "," << book.borrowerUsername << ",";
+            if (book.isCheckedOut && book.dueDate != 0)
+                buffer << static_cast<long long>(book.dueDate);
+            buffer << "\n";
+        }
+        std::string contents = buffer.str();
+        std::ofstream output(path, std::ios::binary);
+        output.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    }
+
+    void writeWithFormat(const std::string &path, const std::vector<Book> &books)
+    {
+        std::string contents = BookCsv::format(books);
+        std::ofstream output(path, std::ios::binary);
+        output.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    }
+
+    std::string readFile(const std::string &path)
+    {
+        std::ifstream input(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    }
+
+    template <typename Writer>
+    double rowsPerSecond(Writer writer, const std::string &path, const std::vector<Book> &books)
+    {
+        double best = 0;
+        for (int round = 0; round < ROUNDS; ++round)
+        {
+            auto start = std::chrono::steady_clock::now();
+            writer(path, books);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::max(best, books.size() / elapsed.count());
+        }
+        return best;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    std::string directory = argc > 2 ? argv[2] : "/tmp";
+    std::vector<Book> books = makeBooks(count);
+
+    const std::string endl_path = directory + "/csvbench-endl.csv";
+    const std::string stream_path = directory + "/csvbench-stream.csv";
+    const std::string format_path = directory + "/csvbench-format.csv";
+
+    std::cout << count << " books, best of " << ROUNDS << " rounds\n\n";
+    std::cout << "Rows per second\n";
+    double endl_rate = rowsPerSecond(writeWithEndl, endl_path, books);
+    std::cout << "  ofstream, std::endl per row:     " << endl_rate << "\n";
+    double stream_rate = rowsPerSecond(writeWithStringStream, stream_path, books);
+    std::cout << "  ostringstream, one write:        " << stream_rate << "\n";
+    double format_rate = rowsPerSecond(writeWithFormat, format_path, books);
+    std::cout << "  BookCsv::format, one write:      " << format_rate << " ("
+              << format_rate / endl_rate << "x the std::endl writer)\n";
+
+    std::string expected = readFile(format_path);
+    bool same = readFile(endl_path) == expected && readFile(stream_path) == expected;
+    std::cout << "\nOutputs " << (same ? "identical" : "DIFFER") << "\n";
+
+    std::remove(endl_path.c_str());
+    std::remove(stream_path.c_str());
+    std::remove(format_path.c_str());
+    return same ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+// Compares the front-coded title dictionary with titles kept as one
+// std::string per book: memory, and the cost of the reads the app makes
+// (a 5-row page of the title listing, one book's title, a [J]ump lookup).
+//
+// Usage: TitleDictionaryBench [book count]
+
+#include "TitleDictionary.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    const size_t PAGE_SIZE = 5; // Rows per page in displayPaginatedBooks.
+    const size_t ROUNDS = 200000;
+
+    // Titles shaped like a library's: shared openings, series and editions.
+    std::vector<std::string> makeTitles(size_t count)
+    {
+        const char *openings[] = {"A Brief History of ", "The Art of ", "How to ", "The Complete Guide to ", "Introduction to ",
+                                  "The ", "Advanced ", "Surviving ", "A Field Guide to ", "Notes on "};
+        const char *subjects[] = {"Toasters", "Procrastination", "Meetings", "Cats", "Microwave Cooking", "Dad Jokes",
+                                  "Sock Pairing", "Zombies", "Gardening", "Chess", "Knitting", "Astronomy", "Bread", "Jazz"};
+        std::mt19937 rng(42);
+        std::vector<std::string> titles;
+        titles.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::string title = openings[rng() % 10];
+            title += subjects[rng() % 14];
+            if (rng() % 2 == 0)
+                title += ", Volume " + std::to_string(rng() % 40 + 1);
+            if (rng() % 3 == 0)
+                title += " (" + std::to_string(rng() % 9 + 1) + "th Edition)";
+            titles.push_back(std::move(title));
+        }
+        return titles;
+    }
+
+    size_t stringBytes(const std::vector<std::string> &titles)
+    {
+        // Short titles live inside the std::string itself.
+        const size_t inline_capacity = std::string().capacity();
+        size_t bytes = titles.capacity() * sizeof(std::string);
+        for (const auto &title : titles)
+        {
+            if (title.capacity() > inline_capacity)
+                bytes += title.capacity() + 1;
+        }
+        return bytes;
+    }
+
+    template <typename Body>
+    double nanosPerRound(Body body)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < ROUNDS; ++round)
+            body(round);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / ROUNDS;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    if (count < PAGE_SIZE)
+        count = PAGE_SIZE;
+
+    // Book i has title titles[i]; both stores are built in (title, id) order, as loadBooks does.
+    std::vector<std::string> titles = makeTitles(count);
+    std::vector<uint32_t> order(count);
+    for (size_t i = 0; i < count; ++i)
+        order[i] = static_cast<uint32_t>(i);
+    std::sort(order.begin(), order.end(), [&titles](uint32_t a, uint32_t b)
+              { return titles[a] != titles[b] ? titles[a] < titles[b] : a < b; });
+    std::vector<std::string> sorted;
+    sorted.reserve(count);
+    TitleDictionary dictionary;
+    for (uint32_t id : order)
+    {
+        sorted.push_back(titles[id]);
+        dictionary.add(titles[id], id);
+    }
+
+    std::cout << count << " titles, " << dictionary.rawBytes() << " bytes of text\n\n";
+    std::cout << "Memory\n";
+    std::cout << "  one std::string per book:  " << stringBytes(titles) << " bytes\n";
+    std::cout << "  front-coded dictionary:    " << dictionary.encodedBytes() << " bytes ("
+              << static_cast<double>(stringBytes(titles)) / dictionary.encodedBytes() << "x smaller)\n\n";
+
+    std::mt19937 rng(7);
+    std::vector<size_t> starts(ROUNDS), ids(ROUNDS);
+    for (size_t round = 0; round < ROUNDS; ++round)
+    {
+        starts[round] = rng() % (count - PAGE_SIZE + 1);
+        ids[round] = rng() % count;
+    }
+    std::vector<std::string> keys;
+    for (size_t round = 0; round < 1000; ++round)
+        keys.push_back(titles[rng() % count].substr(0, 12));
+
+    size_t checksum = 0;
+    std::vector<std::string> page;
+    std::cout << "Time per operation (ns)       strings   dictionary\n";
+
+    double copied = nanosPerRound([&](size_t round)
+                                  {
+                                      page.assign(sorted.begin() + starts[round], sorted.begin() + starts[round] + PAGE_SIZE);
+                                      checksum += page.back().size();
+                                  });
+    double decoded = nanosPerRound([&](size_t round)
+                                   {
+                                       dictionary.decodeRange(starts[round], starts[round] + PAGE_SIZE, page);
+                                       checksum += page.back().size();
+                                   });
+    std::cout << "  5-row page of the listing  " << copied << "   " << decoded << "\n";
+
+    std::string title;
+    double indexed = nanosPerRound([&](size_t round)
+                                   {
+                                       title = titles[ids[round]];
+                                       checksum += title.size();
+                                   });
+    double looked_up = nanosPerRound([&](size_t round)
+                                     {
+                                         dictionary.title(static_cast<uint32_t>(ids[round]), title);
+                                         checksum += title.size();
+                                     });
+    std::cout << "  one book's title           " << indexed << "   " << looked_up << "\n";
+
+    double searched = nanosPerRound([&](size_t round)
+                                    { checksum += std::lower_bound(sorted.begin(), sorted.end(), keys[round % keys.size()]) - sorted.begin(); });
+    double bounded = nanosPerRound([&](size_t round)
+                                   { checksum += dictionary.lowerBound(keys[round % keys.size()]); });
+    std::cout << "  jump to a title            " << searched << "   " << bounded << "\n";
+
+    std::cout << "\n(checksum " << checksum << ")\n";
+    return 0;
+}
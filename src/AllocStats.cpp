@@ -0,0 +1,210 @@
+#include "AllocStats.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    const size_t SUBSYSTEM_COUNT = static_cast<size_t>(AllocStats::Subsystem::COUNT);
+
+    struct AtomicCounters
+    {
+        std::atomic<uint64_t> allocations{0};
+        std::atomic<uint64_t> frees{0};
+        std::atomic<uint64_t> bytes_allocated{0};
+        std::atomic<int64_t> live_bytes{0};
+        std::atomic<int64_t> peak_live_bytes{0};
+    };
+
+    // Zero-initialised before any dynamic initialiser runs, so allocations made
+    // during static construction are counted safely.
+    AtomicCounters g_counters[SUBSYSTEM_COUNT];
+    thread_local AllocStats::Subsystem t_current = AllocStats::Subsystem::OTHER;
+}
+
+namespace AllocStats
+{
+    bool enabled()
+    {
+#ifdef LIBRARY_ALLOC_STATS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    const char *name(Subsystem subsystem)
+    {
+        switch (subsystem)
+        {
+        case Subsystem::OTHER:
+            return "Other";
+        case Subsystem::CATALOG:
+            return "Book catalog";
+        case Subsystem::USERS:
+            return "Users";
+        case Subsystem::HOLDS_AND_LOANS:
+            return "Holds and loans";
+        case Subsystem::FUZZY_INDEX:
+            return "Fuzzy index";
+        case Subsystem::TEXT_INDEX:
+            return "BM25 index";
+        case Subsystem::TITLE_DICTIONARY:
+            return "Title dictionary";
+        case Subsystem::FACET_INDEX:
+            return "Facet bitmaps";
+        case Subsystem::SEARCH_CACHE:
+            return "Search cache";
+        case Subsystem::SEARCH:
+            return "Search temporaries";
+        case Subsystem::DISPLAY:
+            return "Listing temporaries";
+        case Subsystem::COUNT:
+            break;
+        }
+        return "?";
+    }
+
+    Counters counters(Subsystem subsystem)
+    {
+        const AtomicCounters &source = g_counters[static_cast<size_t>(subsystem)];
+        Counters result;
+        result.allocations = source.allocations.load(std::memory_order_relaxed);
+        result.frees = source.frees.load(std::memory_order_relaxed);
+        result.bytes_allocated = source.bytes_allocated.load(std::memory_order_relaxed);
+        result.live_bytes = source.live_bytes.load(std::memory_order_relaxed);
+        result.peak_live_bytes = source.peak_live_bytes.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    Subsystem current()
+    {
+        return t_current;
+    }
+
+    void setCurrent(Subsystem subsystem)
+    {
+        t_current = subsystem;
+    }
+}
+
+#ifdef LIBRARY_ALLOC_STATS
+
+namespace
+{
+    // 16 bytes keeps the user pointer aligned for any fundamental type.
+    struct BlockHeader
+    {
+        uint64_t size;
+        uint32_t subsystem;
+        uint32_t magic;
+    };
+    static_assert(sizeof(BlockHeader) == 16, "header must preserve malloc alignment");
+
+    const uint32_t BLOCK_MAGIC = 0xA110C8EDu;
+
+    void *countedAlloc(size_t size)
+    {
+        auto *header = static_cast<BlockHeader *>(std::malloc(sizeof(BlockHeader) + size));
+        if (header == nullptr)
+            return nullptr;
+        size_t index = static_cast<size_t>(t_current);
+        header->size = size;
+        header->subsystem = static_cast<uint32_t>(index);
+        header->magic = BLOCK_MAGIC;
+
+        AtomicCounters &counters = g_counters[index];
+        counters.allocations.fetch_add(1, std::memory_order_relaxed);
+        counters.bytes_allocated.fetch_add(size, std::memory_order_relaxed);
+        int64_t live = counters.live_bytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) + static_cast<int64_t>(size);
+        int64_t peak = counters.peak_live_bytes.load(std::memory_order_relaxed);
+        while (live > peak && !counters.peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {
+        }
+        return header + 1;
+    }
+
+    void *countedAllocOrThrow(size_t size)
+    {
+        if (size == 0)
+            size = 1;
+        while (true)
+        {
+            void *pointer = countedAlloc(size);
+            if (pointer != nullptr)
+                return pointer;
+            std::new_handler handler = std::get_new_handler();
+            if (handler == nullptr)
+                throw std::bad_alloc();
+            handler();
+        }
+    }
+
+    void countedFree(void *pointer)
+    {
+        if (pointer == nullptr)
+            return;
+        BlockHeader *header = static_cast<BlockHeader *>(pointer) - 1;
+        if (header->magic == BLOCK_MAGIC && header->subsystem < SUBSYSTEM_COUNT)
+        {
+            AtomicCounters &counters = g_counters[header->subsystem];
+            counters.frees.fetch_add(1, std::memory_order_relaxed);
+            counters.live_bytes.fetch_sub(static_cast<int64_t>(header->size), std::memory_order_relaxed);
+        }
+        header->magic = 0;
+        std::free(header);
+    }
+}
+
+void *operator new(size_t size)
+{
+    return countedAllocOrThrow(size);
+}
+
+void *operator new[](size_t size)
+{
+    return countedAllocOrThrow(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return countedAlloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return countedAlloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    countedFree(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    countedFree(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    countedFree(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+    countedFree(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept
+{
+    countedFree(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept
+{
+    countedFree(pointer);
+}
+
+#endif // LIBRARY_ALLOC_STATS
@@ -0,0 +1,65 @@
+#ifndef ALLOCSTATS_H
+#define ALLOCSTATS_H
+
+#include <cstdint>
+
+// Optional heap accounting, built in with -DLIBRARY_ENABLE_ALLOC_STATS=ON.
+// The global operator new/delete are replaced with versions that put a small
+// header in front of every block recording its size and the subsystem that
+// allocated it, so frees are charged back to the right subsystem even when
+// they happen elsewhere. The subsystem is whatever AllocScope is active on
+// the allocating thread. When the option is off everything here is a no-op.
+namespace AllocStats
+{
+    enum class Subsystem : uint8_t
+    {
+        OTHER,
+        CATALOG,
+        USERS,
+        HOLDS_AND_LOANS,
+        FUZZY_INDEX,
+        TEXT_INDEX,
+        TITLE_DICTIONARY,
+        FACET_INDEX,
+        SEARCH_CACHE,
+        SEARCH,  // Temporaries of a search.
+        DISPLAY, // Temporaries of a listing.
+        COUNT
+    };
+
+    struct Counters
+    {
+        uint64_t allocations = 0;
+        uint64_t frees = 0;
+        uint64_t bytes_allocated = 0; // Total over the run.
+        int64_t live_bytes = 0;
+        int64_t peak_live_bytes = 0;
+    };
+
+    bool enabled();
+    const char *name(Subsystem subsystem);
+    Counters counters(Subsystem subsystem);
+
+    Subsystem current();
+    void setCurrent(Subsystem subsystem);
+}
+
+// Charges allocations made on this thread to `subsystem` until destroyed.
+class AllocScope
+{
+public:
+    explicit AllocScope(AllocStats::Subsystem subsystem)
+        : m_previous(AllocStats::current())
+    {
+        AllocStats::setCurrent(subsystem);
+    }
+    ~AllocScope() { AllocStats::setCurrent(m_previous); }
+
+    AllocScope(const AllocScope &) = delete;
+    AllocScope &operator=(const AllocScope &) = delete;
+
+private:
+    AllocStats::Subsystem m_previous;
+};
+
+#endif // ALLOCSTATS_H
@@ -0,0 +1,239 @@
+#include "Bm25Index.h"
+#include "Tokenizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+namespace
+{
+    const double K1 = 1.2;
+    const double B = 0.75;
+}
+
+// Position inside one query word's posting list.
+struct Bm25Index::Cursor
+{
+    const std::vector<Posting> *postings;
+    size_t position;
+    uint32_t term;
+
+    bool done() const { return position >= postings->size(); }
+    uint32_t doc() const { return done() ? UINT32_MAX : (*postings)[position].doc; }
+};
+
+void Bm25Index::clear()
+{
+    m_term_ids.clear();
+    m_terms.clear();
+    m_doc_lengths.clear();
+    m_doc_count = 0;
+    m_average_length = 0.0;
+    m_finalized = false;
+    m_changes_since_finalize = 0;
+}
+
+void Bm25Index::addDocument(uint32_t doc, const std::string &text)
+{
+    std::vector<std::string> tokens = tokenizeText(text);
+    if (doc >= m_doc_lengths.size())
+        m_doc_lengths.resize(doc + 1, 0);
+    m_doc_lengths[doc] = static_cast<uint32_t>(tokens.size());
+    m_doc_count++;
+    std::vector<uint32_t> touched;
+    for (const auto &token : tokens)
+    {
+        auto it = m_term_ids.find(token);
+        if (it == m_term_ids.end())
+        {
+            it = m_term_ids.emplace(token, static_cast<uint32_t>(m_terms.size())).first;
+            m_terms.emplace_back();
+        }
+        std::vector<Posting> &postings = m_terms[it->second].postings;
+        if (postings.empty() || postings.back().doc < doc)
+        {
+            postings.push_back({doc, 1});
+        }
+        else if (postings.back().doc == doc)
+        {
+            postings.back().term_frequency++;
+        }
+        else
+        {
+            // Out of order (an incremental add): keep the list sorted by doc.
+            auto pos = std::lower_bound(postings.begin(), postings.end(), doc, [](const Posting &posting, uint32_t value)
+                                        { return posting.doc < value; });
+            if (pos != postings.end() && pos->doc == doc)
+                pos->term_frequency++;
+            else
+                postings.insert(pos, {doc, 1});
+        }
+        if (m_finalized)
+            touched.push_back(it->second);
+    }
+    if (m_finalized)
+        noteChanged(touched);
+}
+
+void Bm25Index::removeDocument(uint32_t doc, const std::string &text)
+{
+    if (doc >= m_doc_lengths.size())
+        return;
+    std::vector<std::string> tokens = tokenizeText(text);
+    std::sort(tokens.begin(), tokens.end());
+    tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+
+    std::vector<uint32_t> touched;
+    for (const auto &token : tokens)
+    {
+        auto it = m_term_ids.find(token);
+        if (it == m_term_ids.end())
+            continue;
+        // Terms whose list empties keep their id; a later add reuses it.
+        std::vector<Posting> &postings = m_terms[it->second].postings;
+        auto pos = std::lower_bound(postings.begin(), postings.end(), doc, [](const Posting &posting, uint32_t value)
+                                    { return posting.doc < value; });
+        if (pos == postings.end() || pos->doc != doc)
+            continue;
+        postings.erase(pos);
+        touched.push_back(it->second);
+    }
+    m_doc_lengths[doc] = 0;
+    m_doc_count--;
+    if (m_finalized)
+        noteChanged(touched);
+}
+
+void Bm25Index::finalize()
+{
+    uint64_t total_length = 0;
+    for (uint32_t length : m_doc_lengths)
+        total_length += length;
+    const double doc_count = static_cast<double>(m_doc_count);
+    m_average_length = (m_doc_count == 0) ? 0.0 : static_cast<double>(total_length) / doc_count;
+
+    for (auto &term : m_terms)
+        refreshTerm(term);
+    m_finalized = true;
+    m_changes_since_finalize = 0;
+}
+
+// Uses the stored average length, so max_score stays an upper bound of what
+// termScore() returns until the next finalize().
+void Bm25Index::refreshTerm(Term &term)
+{
+    const double doc_count = static_cast<double>(m_doc_count);
+    const double df = static_cast<double>(term.postings.size());
+    term.idf = std::log(1.0 + (doc_count - df + 0.5) / (df + 0.5));
+    term.max_score = 0.0;
+    for (const auto &posting : term.postings)
+        term.max_score = std::max(term.max_score, termScore(term, posting));
+}
+
+void Bm25Index::noteChanged(const std::vector<uint32_t> &terms)
+{
+    if (++m_changes_since_finalize > m_doc_count / 10)
+    {
+        finalize();
+        return;
+    }
+    for (uint32_t term : terms)
+        refreshTerm(m_terms[term]);
+}
+
+double Bm25Index::termScore(const Term &term, const Posting &posting) const
+{
+    const double tf = posting.term_frequency;
+    const double length = m_doc_lengths[posting.doc];
+    const double norm = K1 * (1.0 - B + B * length / (m_average_length > 0.0 ? m_average_length : 1.0));
+    return term.idf * tf * (K1 + 1.0) / (tf + norm);
+}
+
+std::vector<Bm25Index::Hit> Bm25Index::search(const std::string &query, size_t k) const
+{
+    std::vector<std::string> words = tokenizeText(query);
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    std::vector<Cursor> cursors;
+    for (const auto &word : words)
+    {
+        auto it = m_term_ids.find(word);
+        if (it != m_term_ids.end())
+            cursors.push_back({&m_terms[it->second].postings, 0, it->second});
+    }
+    if (cursors.empty() || k == 0)
+        return {};
+
+    auto worse = [](const Hit &a, const Hit &b)
+    { return a.score > b.score || (a.score == b.score && a.doc < b.doc); };
+    std::priority_queue<Hit, std::vector<Hit>, decltype(worse)> heap(worse); // top() = weakest kept hit
+    auto byDoc = [](const Cursor &a, const Cursor &b)
+    { return a.doc() < b.doc(); };
+
+    while (true)
+    {
+        std::sort(cursors.begin(), cursors.end(), byDoc);
+        const double threshold = (heap.size() < k) ? 0.0 : heap.top().score;
+
+        // Pivot: first cursor at which the summed upper bounds can beat the threshold.
+        double bound = 0.0;
+        size_t pivot = cursors.size();
+        for (size_t i = 0; i < cursors.size() && !cursors[i].done(); ++i)
+        {
+            bound += m_terms[cursors[i].term].max_score;
+            if (bound > threshold)
+            {
+                pivot = i;
+                break;
+            }
+        }
+        if (pivot == cursors.size())
+            break; // Nothing left can enter the top k.
+
+        const uint32_t pivot_doc = cursors[pivot].doc();
+        if (cursors[0].doc() == pivot_doc)
+        {
+            // Every cursor up to the pivot sits on pivot_doc: score it fully.
+            double score = 0.0;
+            for (auto &cursor : cursors)
+            {
+                if (cursor.doc() != pivot_doc)
+                    continue;
+                score += termScore(m_terms[cursor.term], (*cursor.postings)[cursor.position]);
+                cursor.position++;
+            }
+            if (heap.size() < k)
+            {
+                heap.push({pivot_doc, score});
+            }
+            else if (score > heap.top().score)
+            {
+                heap.pop();
+                heap.push({pivot_doc, score});
+            }
+        }
+        else
+        {
+            // Skip the lagging cursors straight to the pivot document.
+            for (size_t i = 0; i < pivot; ++i)
+            {
+                Cursor &cursor = cursors[i];
+                auto first = cursor.postings->begin() + cursor.position;
+                auto found = std::lower_bound(first, cursor.postings->end(), pivot_doc, [](const Posting &posting, uint32_t doc)
+                                              { return posting.doc < doc; });
+                cursor.position = static_cast<size_t>(found - cursor.postings->begin());
+            }
+        }
+    }
+
+    std::vector<Hit> hits;
+    hits.reserve(heap.size());
+    while (!heap.empty())
+    {
+        hits.push_back(heap.top());
+        heap.pop();
+    }
+    std::reverse(hits.begin(), hits.end());
+    return hits;
+}
@@ -0,0 +1,67 @@
+#ifndef BM25INDEX_H
+#define BM25INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Ranked full-text index over book titles and authors.
+// An inverted index (word -> books containing it) scored with Okapi BM25.
+// Queries keep only the best k books in a bounded min-heap, and use WAND:
+// each word's best possible score is known up front, so books that cannot
+// beat the current k-th best are skipped without being scored.
+// After finalize(), documents can still be added and removed one at a time:
+// only the statistics of the words they contain are refreshed. The
+// collection-wide ones (document count, average length) catch up at the next
+// finalize(), which runs by itself once a tenth of the documents have changed.
+class Bm25Index
+{
+public:
+    struct Hit
+    {
+        uint32_t doc = 0;
+        double score = 0.0;
+    };
+
+    void clear();
+    // Building is fastest in increasing doc order; call finalize() afterwards.
+    void addDocument(uint32_t doc, const std::string &text);
+    // `text` must be what the document was added with.
+    void removeDocument(uint32_t doc, const std::string &text);
+    void finalize();
+
+    // Highest score first.
+    std::vector<Hit> search(const std::string &query, size_t k) const;
+
+private:
+    struct Posting
+    {
+        uint32_t doc;
+        uint32_t term_frequency;
+    };
+
+    struct Term
+    {
+        std::vector<Posting> postings;
+        double idf = 0.0;
+        double max_score = 0.0; // Upper bound of this term's contribution to any document.
+    };
+
+    struct Cursor;
+
+    double termScore(const Term &term, const Posting &posting) const;
+    void refreshTerm(Term &term);
+    // Called after each incremental add or remove.
+    void noteChanged(const std::vector<uint32_t> &terms);
+
+    std::unordered_map<std::string, uint32_t> m_term_ids;
+    std::vector<Term> m_terms;
+    std::vector<uint32_t> m_doc_lengths; // Indexed by doc; words per document.
+    size_t m_doc_count = 0;
+    double m_average_length = 0.0;
+    bool m_finalized = false;
+    size_t m_changes_since_finalize = 0;
+};
+
+#endif // BM25INDEX_H
@@ -2,6 +2,7 @@
 #define BOOK_H
 
 #include <string>
+#include <ctime>
 
 // This class is a simple data container. Its only job is to hold the
 // information for a single book.
@@ -10,11 +11,12 @@ class Book
 public:
     // --- Properties ---
     std::string isbn;
-    int copyId; // +++ ADDED: To track individual copies of the same book.
+    int copyId = 0; // +++ ADDED: To track individual copies of the same book.
     std::string title;
     std::string author;
     bool isCheckedOut = false;
     std::string borrowerUsername = "";
+    std::time_t dueDate = 0; // +++ ADDED: When the current loan is due back (0 = not on loan / unknown).
 };
 
 #endif // BOOK_H
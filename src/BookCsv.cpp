@@ -0,0 +1,55 @@
+#include "BookCsv.h"
+#include "Csv.h"
+
+#include <cstdlib>
+
+namespace BookCsv
+{
+    void parse(const std::string &contents, std::vector<Book> &books)
+    {
+        std::vector<std::string> fields;
+        size_t offset = 0;
+        while (Csv::readRecord(contents, offset, fields))
+        {
+            if (Csv::isBlank(fields))
+                continue;
+            fields.resize(6); // Older files stop after the borrower.
+
+            Book newBook;
+            newBook.isbn = std::move(fields[0]);
+            newBook.title = std::move(fields[1]);
+            newBook.author = std::move(fields[2]);
+            newBook.isCheckedOut = (fields[3] == "1");
+            newBook.borrowerUsername = std::move(fields[4]);
+            newBook.dueDate = fields[5].empty() ? 0 : static_cast<std::time_t>(std::strtoll(fields[5].c_str(), nullptr, 10));
+            books.push_back(std::move(newBook));
+        }
+    }
+
+    void appendRow(std::string &output, const Book &book, const std::string &title)
+    {
+        Csv::appendField(output, book.isbn);
+        output += ',';
+        Csv::appendField(output, title);
+        output += ',';
+        Csv::appendField(output, book.author);
+        output += book.isCheckedOut ? ",1," : ",0,";
+        Csv::appendField(output, book.borrowerUsername);
+        output += ',';
+        if (book.isCheckedOut && book.dueDate != 0)
+            Csv::appendInteger(output, static_cast<long long>(book.dueDate));
+        output += '\n';
+    }
+
+    std::string format(const std::vector<Book> &books)
+    {
+        size_t estimate = 0;
+        for (const auto &book : books)
+            estimate += book.isbn.size() + book.title.size() + book.author.size() + book.borrowerUsername.size() + 32;
+        std::string output;
+        output.reserve(estimate);
+        for (const auto &book : books)
+            appendRow(output, book, book.title);
+        return output;
+    }
+}
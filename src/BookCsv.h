@@ -0,0 +1,22 @@
+#ifndef BOOKCSV_H
+#define BOOKCSV_H
+
+#include "Book.h"
+#include <string>
+#include <vector>
+
+// The rows of books.csv: isbn,title,author,checked out,borrower,due date.
+// Shared by the app and the CSV benchmark.
+namespace BookCsv
+{
+    // Appends a book for every non-blank record in `contents`.
+    void parse(const std::string &contents, std::vector<Book> &books);
+
+    // `title` is passed separately: records in m_books keep theirs in the title dictionary.
+    void appendRow(std::string &output, const Book &book, const std::string &title);
+
+    // Sized up front and filled field by field, so a save is one allocation and one string.
+    std::string format(const std::vector<Book> &books);
+}
+
+#endif // BOOKCSV_H
@@ -0,0 +1,472 @@
+#include "BookPageStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    const char MAGIC[8] = {'L', 'I', 'B', 'B', 'P', 'T', '0', '3'};
+    const size_t KEY_SIZE = 24;
+    const uint32_t FLAG_UNEXPORTED = 1;
+
+    struct MetaPage
+    {
+        char magic[8];
+        uint32_t root;
+        uint32_t flags; // FLAG_UNEXPORTED.
+        uint64_t record_count;
+    };
+
+    struct NodeHeader
+    {
+        uint8_t is_leaf;
+        uint8_t reserved;
+        uint16_t count;
+        uint32_t next_leaf; // Leaves only; 0 = none (page 0 is the meta page).
+    };
+
+    // Fixed-width fields are not NUL-terminated when completely full.
+    struct BookRecord
+    {
+        char isbn[KEY_SIZE];
+        char title[128];
+        char author[80];
+        char borrower[32];
+        int32_t copy_id;
+        uint8_t checked_out;
+        uint8_t reserved[3];
+        int64_t due_date;
+    };
+
+    const size_t LEAF_CAPACITY = (BufferPool::PAGE_SIZE - sizeof(NodeHeader)) / sizeof(BookRecord);
+    const size_t INTERNAL_CAPACITY = (BufferPool::PAGE_SIZE - sizeof(NodeHeader) - sizeof(uint32_t)) /
+                                     (KEY_SIZE + sizeof(int32_t) + sizeof(uint32_t));
+
+    struct LeafNode
+    {
+        NodeHeader header;
+        BookRecord records[LEAF_CAPACITY];
+    };
+
+    // children[i] holds keys < (keys[i], key_copies[i]); children[count] holds the rest.
+    struct InternalNode
+    {
+        NodeHeader header;
+        uint32_t children[INTERNAL_CAPACITY + 1];
+        int32_t key_copies[INTERNAL_CAPACITY];
+        char keys[INTERNAL_CAPACITY][KEY_SIZE];
+    };
+
+    static_assert(sizeof(LeafNode) <= BufferPool::PAGE_SIZE, "leaf must fit in a page");
+    static_assert(sizeof(InternalNode) <= BufferPool::PAGE_SIZE, "internal node must fit in a page");
+
+    std::string readField(const char *field, size_t size)
+    {
+        return std::string(field, strnlen(field, size));
+    }
+
+    void writeField(char *field, size_t size, const std::string &value)
+    {
+        std::memset(field, 0, size);
+        std::memcpy(field, value.data(), std::min(size, value.size()));
+    }
+
+    // Records are ordered by ISBN, then copy id.
+    int compareKey(const char *key, int32_t key_copy, const std::string &isbn, int32_t copy_id)
+    {
+        int order = readField(key, KEY_SIZE).compare(isbn);
+        if (order != 0)
+            return order;
+        return key_copy < copy_id ? -1 : (key_copy > copy_id ? 1 : 0);
+    }
+
+    void toRecord(const Book &book, BookRecord &record)
+    {
+        writeField(record.isbn, sizeof(record.isbn), book.isbn);
+        writeField(record.title, sizeof(record.title), book.title);
+        writeField(record.author, sizeof(record.author), book.author);
+        writeField(record.borrower, sizeof(record.borrower), book.borrowerUsername);
+        record.copy_id = book.copyId;
+        record.checked_out = book.isCheckedOut ? 1 : 0;
+        record.due_date = static_cast<int64_t>(book.dueDate);
+        std::memset(record.reserved, 0, sizeof(record.reserved));
+    }
+
+    void toBook(const BookRecord &record, Book &book)
+    {
+        book.isbn = readField(record.isbn, sizeof(record.isbn));
+        book.title = readField(record.title, sizeof(record.title));
+        book.author = readField(record.author, sizeof(record.author));
+        book.borrowerUsername = readField(record.borrower, sizeof(record.borrower));
+        book.copyId = record.copy_id;
+        book.isCheckedOut = record.checked_out != 0;
+        book.dueDate = static_cast<std::time_t>(record.due_date);
+    }
+
+    // First record whose key is >= (isbn, copy_id).
+    size_t leafLowerBound(const LeafNode &leaf, const std::string &isbn, int32_t copy_id)
+    {
+        size_t lo = 0, hi = leaf.header.count;
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+            if (compareKey(leaf.records[mid].isbn, leaf.records[mid].copy_id, isbn, copy_id) < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    // Index of the child subtree that may contain (isbn, copy_id).
+    size_t childIndex(const InternalNode &node, const std::string &isbn, int32_t copy_id)
+    {
+        size_t lo = 0, hi = node.header.count;
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+            if (compareKey(node.keys[mid], node.key_copies[mid], isbn, copy_id) <= 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+}
+
+BookPageStore::~BookPageStore()
+{
+    close();
+}
+
+bool BookPageStore::open(const std::string &path, size_t pool_pages)
+{
+    close();
+    if (!m_pool.open(path, pool_pages))
+        return false;
+
+    if (m_pool.pageCount() == 0)
+    {
+        // Fresh file: meta page plus an empty root leaf.
+        uint32_t meta_id = 0, root_id = 0;
+        PageRef meta(m_pool, meta_id, m_pool.allocate(meta_id));
+        PageRef root(m_pool, root_id, m_pool.allocate(root_id));
+        if (!meta.valid() || !root.valid())
+            return false;
+        reinterpret_cast<NodeHeader *>(root.data())->is_leaf = 1;
+        root.markDirty();
+        m_root = root_id;
+        m_record_count = 0;
+        m_unexported = false;
+        return writeMeta() && m_pool.flushAll();
+    }
+
+    PageRef meta(m_pool, 0);
+    if (!meta.valid())
+        return false;
+    const MetaPage *header = reinterpret_cast<const MetaPage *>(meta.data());
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        m_pool.close();
+        return false;
+    }
+    m_root = header->root;
+    m_record_count = header->record_count;
+    m_unexported = (header->flags & FLAG_UNEXPORTED) != 0;
+    return true;
+}
+
+void BookPageStore::close()
+{
+    if (!m_pool.isOpen())
+        return;
+    flush();
+    m_pool.close();
+}
+
+bool BookPageStore::fits(const Book &book)
+{
+    const BookRecord *record = nullptr;
+    return !book.isbn.empty() && book.isbn.size() <= sizeof(record->isbn) &&
+           book.title.size() <= sizeof(record->title) &&
+           book.author.size() <= sizeof(record->author) &&
+           book.borrowerUsername.size() <= sizeof(record->borrower);
+}
+
+uint32_t BookPageStore::findLeaf(const std::string &isbn, int32_t copy_id)
+{
+    uint32_t page_id = m_root;
+    while (true)
+    {
+        PageRef page(m_pool, page_id);
+        if (!page.valid())
+            return 0;
+        const InternalNode *node = reinterpret_cast<const InternalNode *>(page.data());
+        if (node->header.is_leaf)
+            return page_id;
+        page_id = node->children[childIndex(*node, isbn, copy_id)];
+    }
+}
+
+bool BookPageStore::find(const std::string &isbn, int32_t copy_id, Book &out)
+{
+    uint32_t leaf_id = findLeaf(isbn, copy_id);
+    if (leaf_id == 0)
+        return false;
+    PageRef page(m_pool, leaf_id);
+    if (!page.valid())
+        return false;
+    const LeafNode *leaf = reinterpret_cast<const LeafNode *>(page.data());
+    size_t pos = leafLowerBound(*leaf, isbn, copy_id);
+    if (pos >= leaf->header.count || compareKey(leaf->records[pos].isbn, leaf->records[pos].copy_id, isbn, copy_id) != 0)
+        return false;
+    toBook(leaf->records[pos], out);
+    return true;
+}
+
+bool BookPageStore::put(const Book &book)
+{
+    if (!isOpen() || !fits(book))
+        return false;
+
+    bool inserted = false;
+    Split split;
+    if (!insertInto(m_root, book, inserted, split))
+        return false;
+
+    if (split.happened)
+    {
+        // The root split: grow the tree by one level.
+        uint32_t new_root_id = 0;
+        PageRef root(m_pool, new_root_id, m_pool.allocate(new_root_id));
+        if (!root.valid())
+            return false;
+        InternalNode *node = reinterpret_cast<InternalNode *>(root.data());
+        node->header.is_leaf = 0;
+        node->header.count = 1;
+        node->children[0] = m_root;
+        node->children[1] = split.right_page;
+        writeField(node->keys[0], KEY_SIZE, split.key);
+        node->key_copies[0] = split.key_copy;
+        root.markDirty();
+        m_root = new_root_id;
+    }
+    if (inserted)
+        m_record_count++;
+    return (inserted || split.happened) ? writeMeta() : true;
+}
+
+bool BookPageStore::insertInto(uint32_t page_id, const Book &book, bool &inserted, Split &split)
+{
+    size_t child_pos = 0;
+    uint32_t child_id = 0;
+    {
+        PageRef page(m_pool, page_id);
+        if (!page.valid())
+            return false;
+        LeafNode *leaf = reinterpret_cast<LeafNode *>(page.data());
+        if (leaf->header.is_leaf)
+        {
+            size_t pos = leafLowerBound(*leaf, book.isbn, book.copyId);
+            if (pos < leaf->header.count && compareKey(leaf->records[pos].isbn, leaf->records[pos].copy_id, book.isbn, book.copyId) == 0)
+            {
+                toRecord(book, leaf->records[pos]); // Update in place.
+                page.markDirty();
+                return true;
+            }
+
+            inserted = true;
+            page.markDirty();
+            if (leaf->header.count < LEAF_CAPACITY)
+            {
+                std::memmove(&leaf->records[pos + 1], &leaf->records[pos], (leaf->header.count - pos) * sizeof(BookRecord));
+                toRecord(book, leaf->records[pos]);
+                leaf->header.count++;
+                return true;
+            }
+
+            // Full leaf: move the upper half into a new right sibling.
+            uint32_t right_id = 0;
+            PageRef right_page(m_pool, right_id, m_pool.allocate(right_id));
+            if (!right_page.valid())
+                return false;
+            LeafNode *right = reinterpret_cast<LeafNode *>(right_page.data());
+            right->header.is_leaf = 1;
+
+            size_t keep = (LEAF_CAPACITY + 1) / 2;
+            size_t move = leaf->header.count - keep;
+            std::memcpy(&right->records[0], &leaf->records[keep], move * sizeof(BookRecord));
+            leaf->header.count = static_cast<uint16_t>(keep);
+            right->header.count = static_cast<uint16_t>(move);
+            right->header.next_leaf = leaf->header.next_leaf;
+            leaf->header.next_leaf = right_id;
+
+            LeafNode *target = (pos <= keep) ? leaf : right;
+            size_t target_pos = (pos <= keep) ? pos : pos - keep;
+            std::memmove(&target->records[target_pos + 1], &target->records[target_pos], (target->header.count - target_pos) * sizeof(BookRecord));
+            toRecord(book, target->records[target_pos]);
+            target->header.count++;
+
+            split.happened = true;
+            split.key = readField(right->records[0].isbn, KEY_SIZE);
+            split.key_copy = right->records[0].copy_id;
+            split.right_page = right_id;
+            right_page.markDirty();
+            return true;
+        }
+
+        const InternalNode *node = reinterpret_cast<const InternalNode *>(page.data());
+        child_pos = childIndex(*node, book.isbn, book.copyId);
+        child_id = node->children[child_pos];
+    } // Unpin before descending so a deep insert never pins more than a couple of pages.
+
+    Split child_split;
+    if (!insertInto(child_id, book, inserted, child_split))
+        return false;
+    if (!child_split.happened)
+        return true;
+
+    PageRef page(m_pool, page_id);
+    if (!page.valid())
+        return false;
+    InternalNode *node = reinterpret_cast<InternalNode *>(page.data());
+    page.markDirty();
+    size_t count = node->header.count;
+
+    if (count < INTERNAL_CAPACITY)
+    {
+        std::memmove(node->keys[child_pos + 1], node->keys[child_pos], (count - child_pos) * KEY_SIZE);
+        std::memmove(&node->key_copies[child_pos + 1], &node->key_copies[child_pos], (count - child_pos) * sizeof(int32_t));
+        std::memmove(&node->children[child_pos + 2], &node->children[child_pos + 1], (count - child_pos) * sizeof(uint32_t));
+        writeField(node->keys[child_pos], KEY_SIZE, child_split.key);
+        node->key_copies[child_pos] = child_split.key_copy;
+        node->children[child_pos + 1] = child_split.right_page;
+        node->header.count++;
+        return true;
+    }
+
+    // Full internal node: merge the new separator in, then split around the middle key.
+    std::vector<std::string> keys;
+    std::vector<int32_t> key_copies(node->key_copies, node->key_copies + count);
+    std::vector<uint32_t> children(node->children, node->children + count + 1);
+    for (size_t i = 0; i < count; ++i)
+        keys.push_back(readField(node->keys[i], KEY_SIZE));
+    keys.insert(keys.begin() + child_pos, child_split.key);
+    key_copies.insert(key_copies.begin() + child_pos, child_split.key_copy);
+    children.insert(children.begin() + child_pos + 1, child_split.right_page);
+
+    uint32_t right_id = 0;
+    PageRef right_page(m_pool, right_id, m_pool.allocate(right_id));
+    if (!right_page.valid())
+        return false;
+    InternalNode *right = reinterpret_cast<InternalNode *>(right_page.data());
+    right->header.is_leaf = 0;
+
+    size_t mid = keys.size() / 2;
+    node->header.count = static_cast<uint16_t>(mid);
+    for (size_t i = 0; i < mid; ++i)
+    {
+        writeField(node->keys[i], KEY_SIZE, keys[i]);
+        node->key_copies[i] = key_copies[i];
+        node->children[i] = children[i];
+    }
+    node->children[mid] = children[mid];
+
+    right->header.count = static_cast<uint16_t>(keys.size() - mid - 1);
+    for (size_t i = mid + 1; i < keys.size(); ++i)
+    {
+        writeField(right->keys[i - mid - 1], KEY_SIZE, keys[i]);
+        right->key_copies[i - mid - 1] = key_copies[i];
+        right->children[i - mid - 1] = children[i];
+    }
+    right->children[right->header.count] = children.back();
+
+    split.happened = true;
+    split.key = keys[mid];
+    split.key_copy = key_copies[mid];
+    split.right_page = right_id;
+    right_page.markDirty();
+    return true;
+}
+
+// Removes the record without rebalancing; underfull leaves are simply reused by later inserts.
+bool BookPageStore::erase(const std::string &isbn, int32_t copy_id)
+{
+    uint32_t leaf_id = findLeaf(isbn, copy_id);
+    if (leaf_id == 0)
+        return false;
+    {
+        PageRef page(m_pool, leaf_id);
+        if (!page.valid())
+            return false;
+        LeafNode *leaf = reinterpret_cast<LeafNode *>(page.data());
+        size_t pos = leafLowerBound(*leaf, isbn, copy_id);
+        if (pos >= leaf->header.count || compareKey(leaf->records[pos].isbn, leaf->records[pos].copy_id, isbn, copy_id) != 0)
+            return false;
+        std::memmove(&leaf->records[pos], &leaf->records[pos + 1], (leaf->header.count - pos - 1) * sizeof(BookRecord));
+        leaf->header.count--;
+        page.markDirty();
+    }
+    m_record_count--;
+    return writeMeta();
+}
+
+void BookPageStore::forEach(const std::function<void(const Book &)> &visit)
+{
+    if (!isOpen())
+        return;
+    uint32_t page_id = m_root;
+    while (true)
+    {
+        PageRef page(m_pool, page_id);
+        if (!page.valid())
+            return;
+        const InternalNode *node = reinterpret_cast<const InternalNode *>(page.data());
+        if (node->header.is_leaf)
+            break;
+        page_id = node->children[0];
+    }
+
+    Book book;
+    while (page_id != 0)
+    {
+        PageRef page(m_pool, page_id);
+        if (!page.valid())
+            return;
+        const LeafNode *leaf = reinterpret_cast<const LeafNode *>(page.data());
+        for (size_t i = 0; i < leaf->header.count; ++i)
+        {
+            toBook(leaf->records[i], book);
+            visit(book);
+        }
+        page_id = leaf->header.next_leaf;
+    }
+}
+
+bool BookPageStore::setUnexportedChanges(bool unexported)
+{
+    if (m_unexported == unexported)
+        return true;
+    m_unexported = unexported;
+    return writeMeta();
+}
+
+bool BookPageStore::flush()
+{
+    return isOpen() && writeMeta() && m_pool.flushAll();
+}
+
+bool BookPageStore::writeMeta()
+{
+    PageRef meta(m_pool, 0);
+    if (!meta.valid())
+        return false;
+    MetaPage *header = reinterpret_cast<MetaPage *>(meta.data());
+    std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+    header->root = m_root;
+    header->flags = m_unexported ? FLAG_UNEXPORTED : 0;
+    header->record_count = m_record_count;
+    meta.markDirty();
+    return true;
+}
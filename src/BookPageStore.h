@@ -0,0 +1,65 @@
+#ifndef BOOKPAGESTORE_H
+#define BOOKPAGESTORE_H
+
+#include "Book.h"
+#include "BufferPool.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Single-file B+tree of books keyed by (ISBN, copy id), so every copy of an
+// ISBN gets its own record.
+// Every node is one fixed-size page read through a BufferPool, so memory stays
+// bounded by the pool size no matter how large the catalog file grows, and a
+// lookup costs one page per tree level. Records are fixed-size: put() rejects
+// books whose fields do not fit (see fits()).
+class BookPageStore
+{
+public:
+    BookPageStore() = default;
+    ~BookPageStore();
+
+    bool open(const std::string &path, size_t pool_pages);
+    void close();
+    bool isOpen() const { return m_pool.isOpen(); }
+
+    uint64_t size() const { return m_record_count; }
+    const BufferPool::Stats &poolStats() const { return m_pool.stats(); }
+    size_t poolBytes() const { return m_pool.capacity() * BufferPool::PAGE_SIZE; }
+
+    static bool fits(const Book &book);
+
+    bool find(const std::string &isbn, int32_t copy_id, Book &out);
+    // Inserts the book, or overwrites the record with its ISBN and copy id in place.
+    bool put(const Book &book);
+    bool erase(const std::string &isbn, int32_t copy_id);
+    // Visits every book in (ISBN, copy id) order.
+    void forEach(const std::function<void(const Book &)> &visit);
+
+    // Set while the store holds changes the books file does not have yet (the
+    // owner exports them later); kept in the meta page, so it survives a crash.
+    bool hasUnexportedChanges() const { return m_unexported; }
+    bool setUnexportedChanges(bool unexported);
+
+    bool flush();
+
+private:
+    struct Split
+    {
+        bool happened = false;
+        std::string key;
+        int32_t key_copy = 0;
+        uint32_t right_page = 0;
+    };
+
+    bool insertInto(uint32_t page_id, const Book &book, bool &inserted, Split &split);
+    uint32_t findLeaf(const std::string &isbn, int32_t copy_id);
+    bool writeMeta();
+
+    BufferPool m_pool;
+    uint32_t m_root = 0;
+    uint64_t m_record_count = 0;
+    bool m_unexported = false;
+};
+
+#endif // BOOKPAGESTORE_H
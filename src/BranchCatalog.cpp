@@ -0,0 +1,55 @@
+#include "BranchCatalog.h"
+
+#include <algorithm>
+#include <cctype>
+#include "ParallelSort.h"
+
+BranchCatalog::BranchCatalog(std::string name, std::string books_path)
+    : m_name(std::move(name)), m_books_path(std::move(books_path))
+{
+}
+
+void BranchCatalog::assign(std::vector<Book> books)
+{
+    m_books = std::move(books);
+
+    m_by_title.resize(m_books.size());
+    for (uint32_t i = 0; i < m_by_title.size(); ++i)
+        m_by_title[i] = i;
+    // Same order as the home catalog's title view, so the two can be merged.
+    const std::vector<Book> &sorted = m_books;
+    parallelStableSort(m_by_title, [&sorted](uint32_t a, uint32_t b)
+                       {
+                           int order = sorted[a].title.compare(sorted[b].title);
+                           return order != 0 ? order < 0 : a < b;
+                       });
+
+    m_text_index.clear();
+    for (uint32_t i = 0; i < m_books.size(); ++i)
+        m_text_index.addDocument(i, m_books[i].title + " " + m_books[i].author);
+    m_text_index.finalize();
+}
+
+size_t BranchCatalog::titleLowerBound(const std::string &title) const
+{
+    auto it = std::lower_bound(m_by_title.begin(), m_by_title.end(), title, [this](uint32_t index, const std::string &value)
+                               { return m_books[index].title < value; });
+    return static_cast<size_t>(it - m_by_title.begin());
+}
+
+std::vector<Bm25Index::Hit> BranchCatalog::search(const std::string &query, size_t k) const
+{
+    std::vector<Bm25Index::Hit> hits = m_text_index.search(query, k);
+    if (!hits.empty())
+        return hits;
+
+    auto sameLetter = [](char a, char b)
+    { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); };
+    for (uint32_t i = 0; i < m_books.size() && hits.size() < k; ++i)
+    {
+        const std::string &title = m_books[i].title;
+        if (std::search(title.begin(), title.end(), query.begin(), query.end(), sameLetter) != title.end())
+            hits.push_back({i, 0.0});
+    }
+    return hits;
+}
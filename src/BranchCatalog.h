@@ -0,0 +1,45 @@
+#ifndef BRANCHCATALOG_H
+#define BRANCHCATALOG_H
+
+#include "Book.h"
+#include "Bm25Index.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Another branch's catalog, mounted read-only next to our own.
+// Holds the branch's books together with a title-sorted view and a BM25 index
+// over them, both rebuilt whenever the books are replaced. Const members only
+// read, so several branches can be searched on different threads at once.
+class BranchCatalog
+{
+public:
+    BranchCatalog(std::string name, std::string books_path);
+
+    const std::string &name() const { return m_name; }
+    const std::string &booksPath() const { return m_books_path; }
+
+    // Replaces the books and rebuilds the title view and the text index.
+    void assign(std::vector<Book> books);
+
+    const std::vector<Book> &books() const { return m_books; }
+    // Indexes into books(), sorted by title.
+    const std::vector<uint32_t> &byTitle() const { return m_by_title; }
+    // Position in byTitle() of the first title not less than `title`.
+    size_t titleLowerBound(const std::string &title) const;
+
+    // Ranked on title and author, best first. Falls back to a case-insensitive
+    // title substring match (score 0, up to k matches) when no whole word matches,
+    // like the home catalog's search.
+    std::vector<Bm25Index::Hit> search(const std::string &query, size_t k) const;
+
+private:
+    std::string m_name;
+    std::string m_books_path;
+    std::vector<Book> m_books;
+    std::vector<uint32_t> m_by_title;
+    Bm25Index m_text_index;
+};
+
+#endif // BRANCHCATALOG_H
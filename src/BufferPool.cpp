@@ -0,0 +1,187 @@
+#include "BufferPool.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+BufferPool::~BufferPool()
+{
+    close();
+}
+
+bool BufferPool::open(const std::string &path, size_t capacity_pages)
+{
+    close();
+    if (capacity_pages < 8)
+        capacity_pages = 8; // A B+tree split pins a handful of pages at once.
+
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (m_fd < 0)
+        return false;
+
+    struct stat info;
+    if (::fstat(m_fd, &info) != 0)
+    {
+        close();
+        return false;
+    }
+    m_page_count = static_cast<uint32_t>(info.st_size / PAGE_SIZE);
+
+    m_memory.assign(capacity_pages * PAGE_SIZE, 0);
+    m_frames.assign(capacity_pages, Frame());
+    m_page_table.clear();
+    m_lru.clear();
+    m_stats = Stats();
+    return true;
+}
+
+void BufferPool::close()
+{
+    if (m_fd < 0)
+        return;
+    flushAll();
+    ::close(m_fd);
+    m_fd = -1;
+    m_page_count = 0;
+    m_memory.clear();
+    m_frames.clear();
+    m_page_table.clear();
+    m_lru.clear();
+}
+
+char *BufferPool::fetch(uint32_t page_id)
+{
+    if (m_fd < 0 || page_id >= m_page_count)
+        return nullptr;
+
+    auto it = m_page_table.find(page_id);
+    if (it != m_page_table.end())
+    {
+        Frame &frame = m_frames[it->second];
+        frame.pins++;
+        m_lru.splice(m_lru.begin(), m_lru, frame.lru_position);
+        m_stats.hits++;
+        return frameData(it->second);
+    }
+
+    int victim = findVictim();
+    if (victim < 0)
+        return nullptr;
+
+    char *data = frameData(victim);
+    size_t done = 0;
+    while (done < PAGE_SIZE)
+    {
+        ssize_t got = ::pread(m_fd, data + done, PAGE_SIZE - done, static_cast<off_t>(page_id) * PAGE_SIZE + done);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return nullptr;
+        done += static_cast<size_t>(got);
+    }
+    m_stats.misses++;
+
+    Frame &frame = m_frames[victim];
+    frame.page_id = page_id;
+    frame.in_use = true;
+    frame.dirty = false;
+    frame.pins = 1;
+    m_lru.push_front(victim);
+    frame.lru_position = m_lru.begin();
+    m_page_table[page_id] = victim;
+    return data;
+}
+
+char *BufferPool::allocate(uint32_t &page_id)
+{
+    if (m_fd < 0)
+        return nullptr;
+
+    int victim = findVictim();
+    if (victim < 0)
+        return nullptr;
+
+    page_id = m_page_count++;
+    char *data = frameData(victim);
+    std::memset(data, 0, PAGE_SIZE);
+
+    Frame &frame = m_frames[victim];
+    frame.page_id = page_id;
+    frame.in_use = true;
+    frame.dirty = true; // Must reach the file even if never touched again.
+    frame.pins = 1;
+    m_lru.push_front(victim);
+    frame.lru_position = m_lru.begin();
+    m_page_table[page_id] = victim;
+    return data;
+}
+
+void BufferPool::unpin(uint32_t page_id, bool dirty)
+{
+    auto it = m_page_table.find(page_id);
+    if (it == m_page_table.end())
+        return;
+    Frame &frame = m_frames[it->second];
+    if (frame.pins > 0)
+        frame.pins--;
+    frame.dirty = frame.dirty || dirty;
+}
+
+bool BufferPool::flushAll()
+{
+    if (m_fd < 0)
+        return false;
+    bool ok = true;
+    for (size_t i = 0; i < m_frames.size(); ++i)
+    {
+        if (m_frames[i].in_use && m_frames[i].dirty)
+            ok = writeFrame(i) && ok;
+    }
+    return ::fsync(m_fd) == 0 && ok;
+}
+
+// Returns a free frame, or evicts the least recently used unpinned page.
+int BufferPool::findVictim()
+{
+    for (size_t i = 0; i < m_frames.size(); ++i)
+    {
+        if (!m_frames[i].in_use)
+            return static_cast<int>(i);
+    }
+    for (auto it = m_lru.rbegin(); it != m_lru.rend(); ++it)
+    {
+        size_t index = *it;
+        Frame &frame = m_frames[index];
+        if (frame.pins > 0)
+            continue;
+        if (frame.dirty && !writeFrame(index))
+            return -1;
+        m_page_table.erase(frame.page_id);
+        m_lru.erase(frame.lru_position);
+        frame.in_use = false;
+        m_stats.evictions++;
+        return static_cast<int>(index);
+    }
+    return -1;
+}
+
+bool BufferPool::writeFrame(size_t frame_index)
+{
+    Frame &frame = m_frames[frame_index];
+    const char *data = frameData(frame_index);
+    size_t done = 0;
+    while (done < PAGE_SIZE)
+    {
+        ssize_t put = ::pwrite(m_fd, data + done, PAGE_SIZE - done, static_cast<off_t>(frame.page_id) * PAGE_SIZE + done);
+        if (put < 0 && errno == EINTR)
+            continue;
+        if (put <= 0)
+            return false;
+        done += static_cast<size_t>(put);
+    }
+    frame.dirty = false;
+    m_stats.writes++;
+    return true;
+}
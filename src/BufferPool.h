@@ -0,0 +1,100 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Fixed-size page cache over a single file.
+// Holds at most `capacity` pages in memory and evicts the least recently used
+// unpinned page when it needs room, writing it back first if it was modified.
+class BufferPool
+{
+public:
+    static const size_t PAGE_SIZE = 4096;
+
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t writes = 0;
+        uint64_t evictions = 0;
+    };
+
+    BufferPool() = default;
+    ~BufferPool();
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    bool open(const std::string &path, size_t capacity_pages);
+    void close();
+    bool isOpen() const { return m_fd >= 0; }
+
+    uint32_t pageCount() const { return m_page_count; }
+    size_t capacity() const { return m_frames.size(); }
+    const Stats &stats() const { return m_stats; }
+
+    // Pins a page and returns its bytes, or nullptr if it could not be read
+    // or every frame is pinned. Every successful call must be matched by unpin().
+    char *fetch(uint32_t page_id);
+    // Appends a zeroed page to the file and returns it pinned.
+    char *allocate(uint32_t &page_id);
+    void unpin(uint32_t page_id, bool dirty);
+
+    // Writes every dirty page back and fsyncs the file.
+    bool flushAll();
+
+private:
+    struct Frame
+    {
+        uint32_t page_id = 0;
+        bool in_use = false;
+        bool dirty = false;
+        int pins = 0;
+        std::list<size_t>::iterator lru_position;
+    };
+
+    int findVictim();
+    bool writeFrame(size_t frame_index);
+    char *frameData(size_t frame_index) { return m_memory.data() + frame_index * PAGE_SIZE; }
+
+    int m_fd = -1;
+    uint32_t m_page_count = 0;
+    std::vector<char> m_memory;
+    std::vector<Frame> m_frames;
+    std::unordered_map<uint32_t, size_t> m_page_table;
+    std::list<size_t> m_lru; // Front = most recently used.
+    Stats m_stats;
+};
+
+// Pins a page for the lifetime of the object.
+class PageRef
+{
+public:
+    PageRef(BufferPool &pool, uint32_t page_id) : m_pool(pool), m_page_id(page_id), m_data(pool.fetch(page_id)) {}
+    PageRef(BufferPool &pool, uint32_t page_id, char *pinned_data) : m_pool(pool), m_page_id(page_id), m_data(pinned_data) {}
+    ~PageRef()
+    {
+        if (m_data != nullptr)
+            m_pool.unpin(m_page_id, m_dirty);
+    }
+
+    PageRef(const PageRef &) = delete;
+    PageRef &operator=(const PageRef &) = delete;
+
+    bool valid() const { return m_data != nullptr; }
+    uint32_t id() const { return m_page_id; }
+    char *data() { return m_data; }
+    void markDirty() { m_dirty = true; }
+
+private:
+    BufferPool &m_pool;
+    uint32_t m_page_id;
+    char *m_data;
+    bool m_dirty = false;
+};
+
+#endif // BUFFERPOOL_H
@@ -0,0 +1,140 @@
+#include "BufferedWriter.h"
+#include "Csv.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+BufferedWriter::BufferedWriter(size_t capacity)
+    : m_buffer(capacity > 0 ? capacity : 1)
+{
+}
+
+BufferedWriter::~BufferedWriter()
+{
+    close();
+}
+
+bool BufferedWriter::open(const std::string &path)
+{
+    close();
+    m_failed = false;
+    if (path == "-")
+    {
+        m_fd = STDOUT_FILENO;
+        m_owns_fd = false;
+        return true;
+    }
+    m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    m_owns_fd = true;
+    m_failed = (m_fd < 0);
+    return !m_failed;
+}
+
+bool BufferedWriter::close()
+{
+    if (m_fd < 0)
+        return !m_failed;
+    flush();
+    if (m_owns_fd && ::close(m_fd) != 0)
+        m_failed = true;
+    m_fd = -1;
+    return !m_failed;
+}
+
+void BufferedWriter::write(const char *data, size_t length)
+{
+    while (length > 0)
+    {
+        if (m_used == m_buffer.size())
+            flush();
+        size_t chunk = std::min(length, m_buffer.size() - m_used);
+        std::memcpy(m_buffer.data() + m_used, data, chunk);
+        m_used += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+void BufferedWriter::writeCsvField(const std::string &field)
+{
+    if (!Csv::needsQuoting(field))
+    {
+        write(field);
+        return;
+    }
+    put('"');
+    for (char c : field)
+    {
+        if (c == '"')
+            put('"');
+        put(c);
+    }
+    put('"');
+}
+
+void BufferedWriter::writeJsonString(const std::string &text)
+{
+    static const char HEX[] = "0123456789abcdef";
+    put('"');
+    for (unsigned char c : text)
+    {
+        switch (c)
+        {
+        case '"':
+            write("\\\"", 2);
+            break;
+        case '\\':
+            write("\\\\", 2);
+            break;
+        case '\n':
+            write("\\n", 2);
+            break;
+        case '\r':
+            write("\\r", 2);
+            break;
+        case '\t':
+            write("\\t", 2);
+            break;
+        default:
+            if (c < 0x20)
+            {
+                char escape[6] = {'\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 0xF]};
+                write(escape, sizeof(escape));
+            }
+            else
+            {
+                put(static_cast<char>(c));
+            }
+        }
+    }
+    put('"');
+}
+
+bool BufferedWriter::flush()
+{
+    const char *data = m_buffer.data();
+    size_t remaining = m_used;
+    m_used = 0;
+    if (m_fd < 0)
+    {
+        m_failed = m_failed || remaining > 0;
+        return !m_failed;
+    }
+    while (remaining > 0)
+    {
+        ssize_t written = ::write(m_fd, data, remaining);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            m_failed = true;
+            break;
+        }
+        data += written;
+        remaining -= static_cast<size_t>(written);
+    }
+    return !m_failed;
+}
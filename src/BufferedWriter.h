@@ -0,0 +1,53 @@
+#ifndef BUFFEREDWRITER_H
+#define BUFFEREDWRITER_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Output to a file descriptor through one large buffer, so writing many small
+// fields costs a handful of write() calls instead of one per row.
+// Also knows how to emit CSV (RFC 4180) and JSON string fields.
+class BufferedWriter
+{
+public:
+    static const size_t DEFAULT_CAPACITY = 1 << 20;
+
+    explicit BufferedWriter(size_t capacity = DEFAULT_CAPACITY);
+    ~BufferedWriter(); // Flushes and closes.
+
+    BufferedWriter(const BufferedWriter &) = delete;
+    BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+    // "-" means standard output.
+    bool open(const std::string &path);
+    bool close();
+    bool ok() const { return !m_failed; }
+
+    void write(const char *data, size_t length);
+    void write(const std::string &text) { write(text.data(), text.size()); }
+    void write(const char *text) { write(text, std::strlen(text)); }
+    void put(char c)
+    {
+        if (m_used == m_buffer.size())
+            flush();
+        m_buffer[m_used++] = c;
+    }
+
+    // Quotes the field only if it contains a comma, quote or line break.
+    void writeCsvField(const std::string &field);
+    // Writes the text as a quoted JSON string with the required escapes.
+    void writeJsonString(const std::string &text);
+
+    bool flush();
+
+private:
+    std::vector<char> m_buffer;
+    size_t m_used = 0;
+    int m_fd = -1;
+    bool m_owns_fd = false;
+    bool m_failed = false;
+};
+
+#endif // BUFFEREDWRITER_H
@@ -0,0 +1,156 @@
+#include "CatalogExporter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <ctime>
+#include <sstream>
+
+namespace
+{
+    const char *columnName(CatalogExporter::Column column)
+    {
+        switch (column)
+        {
+        case CatalogExporter::Column::ISBN:
+            return "isbn";
+        case CatalogExporter::Column::TITLE:
+            return "title";
+        case CatalogExporter::Column::AUTHOR:
+            return "author";
+        case CatalogExporter::Column::STATUS:
+            return "status";
+        case CatalogExporter::Column::BORROWER:
+            return "borrower";
+        case CatalogExporter::Column::DUE:
+            return "due";
+        }
+        return "";
+    }
+
+    // `scratch` holds values that have to be formatted rather than referenced.
+    const std::string &columnValue(const Book &book, CatalogExporter::Column column, std::string &scratch)
+    {
+        static const std::string AVAILABLE = "available";
+        static const std::string CHECKED_OUT = "checked_out";
+        switch (column)
+        {
+        case CatalogExporter::Column::ISBN:
+            return book.isbn;
+        case CatalogExporter::Column::TITLE:
+            return book.title;
+        case CatalogExporter::Column::AUTHOR:
+            return book.author;
+        case CatalogExporter::Column::STATUS:
+            return book.isCheckedOut ? CHECKED_OUT : AVAILABLE;
+        case CatalogExporter::Column::BORROWER:
+            return book.borrowerUsername;
+        case CatalogExporter::Column::DUE:
+            scratch.clear();
+            if (book.isCheckedOut && book.dueDate != 0)
+            {
+                char date[16];
+                std::strftime(date, sizeof(date), "%Y-%m-%d", std::localtime(&book.dueDate));
+                scratch = date;
+            }
+            return scratch;
+        }
+        return AVAILABLE;
+    }
+
+    // Case-insensitive substring test without allocating a lowered copy of the haystack.
+    bool containsIgnoreCase(const std::string &haystack, const std::string &needle_lower)
+    {
+        auto it = std::search(haystack.begin(), haystack.end(), needle_lower.begin(), needle_lower.end(), [](char a, char b)
+                              { return std::tolower(static_cast<unsigned char>(a)) == b; });
+        return it != haystack.end() || needle_lower.empty();
+    }
+}
+
+CatalogExporter::CatalogExporter(const Options &options)
+    : m_options(options)
+{
+    for (char c : options.author)
+        m_author_lower += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+bool CatalogExporter::parseColumns(const std::string &list, std::vector<Column> &columns)
+{
+    const Column all[] = {Column::ISBN, Column::TITLE, Column::AUTHOR, Column::STATUS, Column::BORROWER, Column::DUE};
+    std::vector<Column> parsed;
+    std::stringstream ss(list);
+    std::string name;
+    while (std::getline(ss, name, ','))
+    {
+        name.erase(std::remove_if(name.begin(), name.end(), ::isspace), name.end());
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        if (name.empty())
+            continue;
+        auto found = std::find_if(std::begin(all), std::end(all), [&](Column column)
+                                  { return name == columnName(column); });
+        if (found == std::end(all))
+            return false;
+        parsed.push_back(*found);
+    }
+    if (parsed.empty())
+        return false;
+    columns = parsed;
+    return true;
+}
+
+void CatalogExporter::writeHeader(BufferedWriter &out) const
+{
+    if (m_options.format != Format::CSV)
+        return; // JSON Lines records are self-describing.
+    for (size_t i = 0; i < m_options.columns.size(); ++i)
+    {
+        if (i > 0)
+            out.put(',');
+        out.write(columnName(m_options.columns[i]));
+    }
+    out.put('\n');
+}
+
+bool CatalogExporter::matches(const Book &book) const
+{
+    if (m_options.status == StatusFilter::AVAILABLE && book.isCheckedOut)
+        return false;
+    if (m_options.status == StatusFilter::CHECKED_OUT && !book.isCheckedOut)
+        return false;
+    if (!m_options.borrower.empty() && book.borrowerUsername != m_options.borrower)
+        return false;
+    return containsIgnoreCase(book.author, m_author_lower);
+}
+
+bool CatalogExporter::writeBook(const Book &book, BufferedWriter &out) const
+{
+    if (!matches(book))
+        return false;
+
+    const std::vector<Column> &columns = m_options.columns;
+    std::string scratch;
+    if (m_options.format == Format::CSV)
+    {
+        for (size_t i = 0; i < columns.size(); ++i)
+        {
+            if (i > 0)
+                out.put(',');
+            out.writeCsvField(columnValue(book, columns[i], scratch));
+        }
+    }
+    else
+    {
+        out.put('{');
+        for (size_t i = 0; i < columns.size(); ++i)
+        {
+            if (i > 0)
+                out.put(',');
+            out.put('"');
+            out.write(columnName(columns[i]));
+            out.write("\":", 2);
+            out.writeJsonString(columnValue(book, columns[i], scratch));
+        }
+        out.put('}');
+    }
+    out.put('\n');
+    return true;
+}
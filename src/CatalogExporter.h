@@ -0,0 +1,63 @@
+#ifndef CATALOGEXPORTER_H
+#define CATALOGEXPORTER_H
+
+#include "Book.h"
+#include "BufferedWriter.h"
+#include <string>
+#include <vector>
+
+// Streams books that pass a filter straight from the catalog into a
+// BufferedWriter as CSV or JSON Lines. Nothing is copied or collected first,
+// so memory use is the writer's buffer no matter how big the catalog is.
+class CatalogExporter
+{
+public:
+    enum class Format
+    {
+        CSV,
+        JSON_LINES
+    };
+
+    enum class StatusFilter
+    {
+        ALL,
+        AVAILABLE,
+        CHECKED_OUT
+    };
+
+    enum class Column
+    {
+        ISBN,
+        TITLE,
+        AUTHOR,
+        STATUS,
+        BORROWER,
+        DUE
+    };
+
+    struct Options
+    {
+        Format format = Format::CSV;
+        StatusFilter status = StatusFilter::ALL;
+        std::string borrower; // Exact username; empty = any.
+        std::string author;   // Case-insensitive substring; empty = any.
+        std::vector<Column> columns = {Column::ISBN, Column::TITLE, Column::AUTHOR, Column::STATUS, Column::BORROWER, Column::DUE};
+    };
+
+    // Parses a comma-separated list such as "isbn,title,due". Returns false on an unknown name.
+    static bool parseColumns(const std::string &list, std::vector<Column> &columns);
+
+    explicit CatalogExporter(const Options &options);
+
+    void writeHeader(BufferedWriter &out) const;
+    // Writes the book if it passes the filters; returns whether it did.
+    bool writeBook(const Book &book, BufferedWriter &out) const;
+
+private:
+    bool matches(const Book &book) const;
+
+    Options m_options;
+    std::string m_author_lower;
+};
+
+#endif // CATALOGEXPORTER_H
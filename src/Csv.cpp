@@ -0,0 +1,117 @@
+#include "Csv.h"
+
+#include <charconv>
+#include <cstring>
+
+namespace Csv
+{
+    bool needsQuoting(const char *data, size_t length)
+    {
+        for (size_t i = 0; i < length; ++i)
+        {
+            char c = data[i];
+            if (c == ',' || c == '"' || c == '\n' || c == '\r')
+                return true;
+        }
+        return false;
+    }
+
+    void appendField(std::string &out, const std::string &field)
+    {
+        if (!needsQuoting(field))
+        {
+            out.append(field);
+            return;
+        }
+        out += '"';
+        size_t start = 0;
+        size_t quote;
+        while ((quote = field.find('"', start)) != std::string::npos)
+        {
+            out.append(field, start, quote + 1 - start);
+            out += '"'; // Doubled.
+            start = quote + 1;
+        }
+        out.append(field, start, std::string::npos);
+        out += '"';
+    }
+
+    void appendInteger(std::string &out, long long value)
+    {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, result.ptr);
+    }
+
+    bool readRecord(const std::string &contents, size_t &offset, std::vector<std::string> &fields)
+    {
+        const size_t size = contents.size();
+        if (offset >= size)
+            return false;
+
+        size_t count = 0;
+        auto nextField = [&]() -> std::string &
+        {
+            if (count == fields.size())
+                fields.emplace_back();
+            std::string &field = fields[count++];
+            field.clear();
+            return field;
+        };
+
+        const char *data = contents.data();
+        size_t pos = offset;
+        while (true)
+        {
+            std::string &field = nextField();
+            if (pos < size && data[pos] == '"')
+            {
+                // Quoted: runs to the next quote that is not doubled.
+                ++pos;
+                while (pos < size)
+                {
+                    const char *quote = static_cast<const char *>(std::memchr(data + pos, '"', size - pos));
+                    size_t end = quote ? static_cast<size_t>(quote - data) : size;
+                    field.append(data + pos, end - pos);
+                    pos = end + 1;
+                    if (quote == nullptr || pos >= size || data[pos] != '"')
+                        break;
+                    field += '"';
+                    ++pos;
+                }
+                // Anything between the closing quote and the delimiter is kept as-is.
+                while (pos < size && data[pos] != ',' && data[pos] != '\n')
+                {
+                    if (data[pos] != '\r')
+                        field += data[pos];
+                    ++pos;
+                }
+            }
+            else
+            {
+                size_t end = pos;
+                while (end < size && data[end] != ',' && data[end] != '\n')
+                    ++end;
+                size_t length = end - pos;
+                if (end < size && data[end] == '\n' && length > 0 && data[end - 1] == '\r')
+                    --length;
+                else if (end == size && length > 0 && data[end - 1] == '\r')
+                    --length;
+                field.assign(data + pos, length);
+                pos = end;
+            }
+
+            if (pos < size && data[pos] == ',')
+            {
+                ++pos;
+                continue;
+            }
+            if (pos < size) // '\n'
+                ++pos;
+            break;
+        }
+        fields.resize(count);
+        offset = pos;
+        return true;
+    }
+}
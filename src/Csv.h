@@ -0,0 +1,29 @@
+#ifndef CSV_H
+#define CSV_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// RFC 4180 fields for the data files. Formatting appends straight onto one
+// contiguous string (the whole file), quoting a field only when it contains
+// a comma, quote or line break. Parsing accepts both quoted and bare fields,
+// so files written before quoting existed still load.
+namespace Csv
+{
+    bool needsQuoting(const char *data, size_t length);
+    inline bool needsQuoting(const std::string &field) { return needsQuoting(field.data(), field.size()); }
+
+    void appendField(std::string &out, const std::string &field);
+    void appendInteger(std::string &out, long long value);
+
+    // Reads the record starting at `offset` into `fields` (reusing their storage)
+    // and moves `offset` past it. Quoted fields may contain commas, doubled
+    // quotes and line breaks. A trailing '\r' is dropped. Returns false at the end.
+    bool readRecord(const std::string &contents, size_t &offset, std::vector<std::string> &fields);
+
+    // A record read from an empty line.
+    inline bool isBlank(const std::vector<std::string> &fields) { return fields.size() == 1 && fields[0].empty(); }
+}
+
+#endif // CSV_H
@@ -0,0 +1,81 @@
+#include "DataFileWatcher.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    void splitPath(const std::string &path, std::string &directory, std::string &name)
+    {
+        size_t slash = path.find_last_of('/');
+        directory = (slash == std::string::npos) ? "." : path.substr(0, slash == 0 ? 1 : slash);
+        name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+    }
+}
+
+DataFileWatcher::~DataFileWatcher()
+{
+#ifdef __linux__
+    if (m_fd >= 0)
+        ::close(m_fd);
+#endif
+}
+
+bool DataFileWatcher::watch(const std::vector<std::string> &paths)
+{
+#ifdef __linux__
+    if (m_fd < 0)
+        m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0)
+        return false;
+
+    for (const auto &path : paths)
+    {
+        std::string directory, name;
+        splitPath(path, directory, name);
+        int wd = inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd < 0)
+            return false;
+        m_directories[wd] = directory;
+        m_files[directory + "/" + name] = path;
+    }
+    return true;
+#else
+    (void)paths;
+    return false;
+#endif
+}
+
+std::set<std::string> DataFileWatcher::poll()
+{
+    std::set<std::string> changed;
+#ifdef __linux__
+    if (m_fd < 0)
+        return changed;
+
+    alignas(struct inotify_event) char buffer[4096];
+    while (true)
+    {
+        ssize_t length = ::read(m_fd, buffer, sizeof(buffer));
+        if (length <= 0)
+            break; // EAGAIN: nothing more queued.
+
+        for (char *p = buffer; p < buffer + length;)
+        {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(p);
+            p += sizeof(struct inotify_event) + event->len;
+            if (event->len == 0)
+                continue;
+            auto dir = m_directories.find(event->wd);
+            if (dir == m_directories.end())
+                continue;
+            auto file = m_files.find(dir->second + "/" + event->name);
+            if (file != m_files.end())
+                changed.insert(file->second);
+        }
+    }
+#endif
+    return changed;
+}
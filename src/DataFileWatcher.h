@@ -0,0 +1,33 @@
+#ifndef DATAFILEWATCHER_H
+#define DATAFILEWATCHER_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// Watches the data files for changes made by other programs (Linux inotify).
+// The parent directories are watched rather than the files themselves, so files
+// replaced by rename (as editors and our own PersistenceWriter do) keep being seen.
+// On other platforms watch() returns false and poll() never reports anything.
+class DataFileWatcher
+{
+public:
+    DataFileWatcher() = default;
+    ~DataFileWatcher();
+
+    DataFileWatcher(const DataFileWatcher &) = delete;
+    DataFileWatcher &operator=(const DataFileWatcher &) = delete;
+
+    bool watch(const std::vector<std::string> &paths);
+
+    // Non-blocking: returns the watched paths written since the last call.
+    std::set<std::string> poll();
+
+private:
+    int m_fd = -1;
+    std::map<int, std::string> m_directories;  // watch descriptor -> directory
+    std::map<std::string, std::string> m_files; // "directory/name" -> path as given to watch()
+};
+
+#endif // DATAFILEWATCHER_H
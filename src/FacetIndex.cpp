@@ -0,0 +1,80 @@
+#include "FacetIndex.h"
+
+#include <algorithm>
+#include <cctype>
+
+void FacetIndex::clear()
+{
+    m_available.clear();
+    m_checked_out.clear();
+    m_author_ids.clear();
+    m_by_author.clear();
+    m_borrower_ids.clear();
+    m_by_borrower.clear();
+}
+
+void FacetIndex::add(uint32_t id, const Book &book)
+{
+    (book.isCheckedOut ? m_checked_out : m_available).add(id);
+
+    auto author = m_author_ids.emplace(authorKey(book.author), static_cast<uint32_t>(m_by_author.size()));
+    if (author.second)
+        m_by_author.emplace_back();
+    m_by_author[author.first->second].add(id);
+
+    if (book.isCheckedOut && !book.borrowerUsername.empty())
+    {
+        auto borrower = m_borrower_ids.emplace(book.borrowerUsername, static_cast<uint32_t>(m_by_borrower.size()));
+        if (borrower.second)
+            m_by_borrower.emplace_back();
+        m_by_borrower[borrower.first->second].add(id);
+    }
+}
+
+void FacetIndex::remove(uint32_t id, const Book &book)
+{
+    (book.isCheckedOut ? m_checked_out : m_available).remove(id);
+
+    // Ids stay assigned when their bitmap empties; clear() starts over.
+    auto author = m_author_ids.find(authorKey(book.author));
+    if (author != m_author_ids.end())
+        m_by_author[author->second].remove(id);
+
+    auto borrower = m_borrower_ids.find(book.borrowerUsername);
+    if (borrower != m_borrower_ids.end())
+        m_by_borrower[borrower->second].remove(id);
+}
+
+const RoaringBitmap *FacetIndex::author(const std::string &name) const
+{
+    auto it = m_author_ids.find(authorKey(name));
+    return it == m_author_ids.end() || m_by_author[it->second].empty() ? nullptr : &m_by_author[it->second];
+}
+
+const RoaringBitmap *FacetIndex::borrower(const std::string &username) const
+{
+    auto it = m_borrower_ids.find(username);
+    return it == m_borrower_ids.end() || m_by_borrower[it->second].empty() ? nullptr : &m_by_borrower[it->second];
+}
+
+size_t FacetIndex::memoryBytes() const
+{
+    size_t bytes = m_available.memoryBytes() + m_checked_out.memoryBytes();
+    for (const auto &bitmap : m_by_author)
+        bytes += sizeof(RoaringBitmap) + bitmap.memoryBytes();
+    for (const auto &bitmap : m_by_borrower)
+        bytes += sizeof(RoaringBitmap) + bitmap.memoryBytes();
+    for (const auto &entry : m_author_ids)
+        bytes += sizeof(entry) + entry.first.capacity();
+    for (const auto &entry : m_borrower_ids)
+        bytes += sizeof(entry) + entry.first.capacity();
+    return bytes;
+}
+
+std::string FacetIndex::authorKey(const std::string &name)
+{
+    std::string key = name;
+    std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c)
+                   { return static_cast<char>(std::tolower(c)); });
+    return key;
+}
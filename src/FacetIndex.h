@@ -0,0 +1,46 @@
+#ifndef FACETINDEX_H
+#define FACETINDEX_H
+
+#include "Book.h"
+#include "RoaringBitmap.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One compressed bitmap of book ids per facet value: available, checked out,
+// each author and each borrower. Authors and borrowers get dense ids the first
+// time they are seen, and their bitmaps are kept in vectors indexed by those
+// ids. Filters are answered by ANDing and ORing bitmaps rather than by
+// scanning the catalog. Ids are the caller's record ids (book slot ids).
+class FacetIndex
+{
+public:
+    void clear();
+    void add(uint32_t id, const Book &book);
+    // `book` must be the record as it was when it was added.
+    void remove(uint32_t id, const Book &book);
+
+    const RoaringBitmap &available() const { return m_available; }
+    const RoaringBitmap &checkedOut() const { return m_checked_out; }
+    // Authors match case-insensitively, borrowers exactly. nullptr if nobody matches.
+    const RoaringBitmap *author(const std::string &name) const;
+    const RoaringBitmap *borrower(const std::string &username) const;
+
+    size_t authorCount() const { return m_by_author.size(); }
+    size_t borrowerCount() const { return m_by_borrower.size(); }
+    size_t memoryBytes() const;
+
+private:
+    static std::string authorKey(const std::string &name);
+
+    RoaringBitmap m_available;
+    RoaringBitmap m_checked_out;
+    std::unordered_map<std::string, uint32_t> m_author_ids; // Lower-cased name -> author id.
+    std::vector<RoaringBitmap> m_by_author;
+    std::unordered_map<std::string, uint32_t> m_borrower_ids;
+    std::vector<RoaringBitmap> m_by_borrower;
+};
+
+#endif // FACETINDEX_H
@@ -0,0 +1,238 @@
+#include "FuzzyIndex.h"
+#include "Tokenizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+
+namespace
+{
+    // Myers' bit-parallel Levenshtein distance, for patterns of up to 64 bytes.
+    // The pattern's match masks are built once and reused against many texts.
+    class MyersPattern
+    {
+    public:
+        explicit MyersPattern(const std::string &pattern) : m_length(pattern.size())
+        {
+            m_peq.fill(0);
+            for (size_t i = 0; i < m_length; ++i)
+                m_peq[static_cast<unsigned char>(pattern[i])] |= uint64_t(1) << i;
+        }
+
+        static bool supports(const std::string &pattern) { return pattern.size() <= 64; }
+
+        int distanceTo(const std::string &text) const
+        {
+            if (m_length == 0)
+                return static_cast<int>(text.size());
+            const uint64_t last = uint64_t(1) << (m_length - 1);
+            uint64_t pv = ~uint64_t(0);
+            uint64_t mv = 0;
+            int score = static_cast<int>(m_length);
+            for (unsigned char c : text)
+            {
+                uint64_t eq = m_peq[c];
+                uint64_t xv = eq | mv;
+                uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+                uint64_t ph = mv | ~(xh | pv);
+                uint64_t mh = pv & xh;
+                if (ph & last)
+                    score++;
+                else if (mh & last)
+                    score--;
+                ph = (ph << 1) | 1; // Row 0 grows by one per text character.
+                mh <<= 1;
+                pv = mh | ~(xv | ph);
+                mv = ph & xv;
+            }
+            return score;
+        }
+
+    private:
+        size_t m_length;
+        std::array<uint64_t, 256> m_peq;
+    };
+
+    int dynamicProgrammingDistance(const std::string &a, const std::string &b)
+    {
+        std::vector<int> row(b.size() + 1);
+        for (size_t j = 0; j <= b.size(); ++j)
+            row[j] = static_cast<int>(j);
+        for (size_t i = 1; i <= a.size(); ++i)
+        {
+            int diagonal = row[0];
+            row[0] = static_cast<int>(i);
+            for (size_t j = 1; j <= b.size(); ++j)
+            {
+                int above = row[j];
+                row[j] = std::min({row[j] + 1, row[j - 1] + 1, diagonal + (a[i - 1] == b[j - 1] ? 0 : 1)});
+                diagonal = above;
+            }
+        }
+        return row[b.size()];
+    }
+}
+
+void FuzzyIndex::clear()
+{
+    m_words.clear();
+    m_postings.clear();
+    m_word_ids.clear();
+    m_nodes.clear();
+}
+
+void FuzzyIndex::addDocument(uint32_t doc, const std::string &text)
+{
+    for (const auto &token : tokenizeText(text))
+    {
+        std::vector<uint32_t> &postings = m_postings[internWord(token)];
+        if (postings.empty() || postings.back() < doc)
+        {
+            postings.push_back(doc);
+            continue;
+        }
+        auto pos = std::lower_bound(postings.begin(), postings.end(), doc);
+        if (*pos != doc)
+            postings.insert(pos, doc);
+    }
+}
+
+void FuzzyIndex::removeDocument(uint32_t doc, const std::string &text)
+{
+    // Words left without documents stay in the tree; they just match nothing.
+    for (const auto &token : tokenizeText(text))
+    {
+        auto word = m_word_ids.find(token);
+        if (word == m_word_ids.end())
+            continue;
+        std::vector<uint32_t> &postings = m_postings[word->second];
+        auto pos = std::lower_bound(postings.begin(), postings.end(), doc);
+        if (pos != postings.end() && *pos == doc)
+            postings.erase(pos);
+    }
+}
+
+uint32_t FuzzyIndex::internWord(const std::string &word)
+{
+    auto it = m_word_ids.find(word);
+    if (it != m_word_ids.end())
+        return it->second;
+    uint32_t id = static_cast<uint32_t>(m_words.size());
+    m_words.push_back(word);
+    m_postings.emplace_back();
+    m_word_ids.emplace(word, id);
+    insertIntoTree(id);
+    return id;
+}
+
+void FuzzyIndex::insertIntoTree(uint32_t word)
+{
+    if (m_nodes.empty())
+    {
+        m_nodes.push_back({word, {}});
+        return;
+    }
+    MyersPattern pattern(m_words[word]);
+    const bool use_myers = MyersPattern::supports(m_words[word]);
+    uint32_t current = 0;
+    while (true)
+    {
+        const std::string &node_word = m_words[m_nodes[current].word];
+        int distance = use_myers ? pattern.distanceTo(node_word) : dynamicProgrammingDistance(m_words[word], node_word);
+        auto &children = m_nodes[current].children;
+        auto child = std::find_if(children.begin(), children.end(), [distance](const std::pair<int, uint32_t> &entry)
+                                  { return entry.first == distance; });
+        if (child == children.end())
+        {
+            uint32_t node = static_cast<uint32_t>(m_nodes.size());
+            children.push_back({distance, node});
+            m_nodes.push_back({word, {}}); // May reallocate: `children` is not used after this.
+            return;
+        }
+        current = child->second;
+    }
+}
+
+std::vector<FuzzyIndex::Match> FuzzyIndex::search(const std::string &query, size_t limit) const
+{
+    std::vector<std::string> words = tokenizeText(query);
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    std::unordered_map<uint32_t, Match> by_doc;
+    std::vector<uint32_t> stack;
+    for (const auto &word : words)
+    {
+        if (m_nodes.empty())
+            break;
+        const int max_edits = maxEditsFor(word.size());
+        MyersPattern pattern(word);
+        const bool use_myers = MyersPattern::supports(word);
+
+        // Closest matching word per book for this query word.
+        std::unordered_map<uint32_t, int> best;
+        stack.assign(1, 0);
+        while (!stack.empty())
+        {
+            const Node &node = m_nodes[stack.back()];
+            stack.pop_back();
+            const std::string &node_word = m_words[node.word];
+            int distance = use_myers ? pattern.distanceTo(node_word) : dynamicProgrammingDistance(word, node_word);
+            if (distance <= max_edits)
+            {
+                for (uint32_t doc : m_postings[node.word])
+                {
+                    auto it = best.find(doc);
+                    if (it == best.end() || distance < it->second)
+                        best[doc] = distance;
+                }
+            }
+            // Triangle inequality: only children at distance d +/- k can hold matches.
+            for (const auto &child : node.children)
+            {
+                if (std::abs(child.first - distance) <= max_edits)
+                    stack.push_back(child.second);
+            }
+        }
+
+        for (const auto &entry : best)
+        {
+            Match &match = by_doc[entry.first];
+            match.doc = entry.first;
+            match.words_matched++;
+            match.total_edits += entry.second;
+        }
+    }
+
+    std::vector<Match> results;
+    results.reserve(by_doc.size());
+    for (const auto &entry : by_doc)
+        results.push_back(entry.second);
+    auto better = [](const Match &a, const Match &b)
+    {
+        if (a.words_matched != b.words_matched)
+            return a.words_matched > b.words_matched;
+        if (a.total_edits != b.total_edits)
+            return a.total_edits < b.total_edits;
+        return a.doc < b.doc;
+    };
+    if (results.size() > limit)
+    {
+        std::partial_sort(results.begin(), results.begin() + limit, results.end(), better);
+        results.resize(limit);
+    }
+    else
+    {
+        std::sort(results.begin(), results.end(), better);
+    }
+    return results;
+}
+
+int FuzzyIndex::maxEditsFor(size_t length)
+{
+    if (length <= 2)
+        return 0;
+    if (length <= 5)
+        return 1;
+    return 2;
+}
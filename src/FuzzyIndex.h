@@ -0,0 +1,52 @@
+#ifndef FUZZYINDEX_H
+#define FUZZYINDEX_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Typo-tolerant word index over book titles and authors.
+// Every distinct word goes into a BK-tree (a metric tree over edit distance),
+// so a query word only visits the part of the vocabulary that can be within
+// k edits of it. Distances use Myers' bit-parallel algorithm.
+class FuzzyIndex
+{
+public:
+    struct Match
+    {
+        uint32_t doc = 0;
+        int words_matched = 0; // How many query words found a close word in this book.
+        int total_edits = 0;   // Sum of the edits over those words.
+    };
+
+    void clear();
+    void addDocument(uint32_t doc, const std::string &text);
+    // `text` must be what the document was added with.
+    void removeDocument(uint32_t doc, const std::string &text);
+
+    // Best matches first: most query words matched, then fewest edits.
+    std::vector<Match> search(const std::string &query, size_t limit) const;
+
+    // Edits allowed for a query word of this length.
+    static int maxEditsFor(size_t length);
+
+    size_t vocabularySize() const { return m_words.size(); }
+
+private:
+    struct Node
+    {
+        uint32_t word;
+        std::vector<std::pair<int, uint32_t>> children; // (distance to this node, child node)
+    };
+
+    uint32_t internWord(const std::string &word);
+    void insertIntoTree(uint32_t word);
+
+    std::vector<std::string> m_words;
+    std::vector<std::vector<uint32_t>> m_postings; // word -> documents containing it, ascending
+    std::unordered_map<std::string, uint32_t> m_word_ids;
+    std::vector<Node> m_nodes; // m_nodes[0] is the root once anything is added.
+};
+
+#endif // FUZZYINDEX_H
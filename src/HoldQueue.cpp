@@ -0,0 +1,100 @@
+#include "HoldQueue.h"
+
+#include <iterator>
+#include <sstream>
+
+size_t HoldQueue::place(const std::string &isbn, const std::string &username)
+{
+    auto &user_holds = m_by_user[username];
+    if (user_holds.count(isbn) > 0)
+        return 0;
+    Queue &queue = m_queues[isbn];
+    queue.push_back(username);
+    user_holds[isbn] = std::prev(queue.end());
+    m_total++;
+    return queue.size();
+}
+
+bool HoldQueue::cancel(const std::string &isbn, const std::string &username)
+{
+    auto user = m_by_user.find(username);
+    if (user == m_by_user.end())
+        return false;
+    auto hold = user->second.find(isbn);
+    if (hold == user->second.end())
+        return false;
+
+    auto queue = m_queues.find(isbn);
+    queue->second.erase(hold->second);
+    if (queue->second.empty())
+        m_queues.erase(queue);
+    user->second.erase(hold);
+    if (user->second.empty())
+        m_by_user.erase(user);
+    m_total--;
+    return true;
+}
+
+bool HoldQueue::popNext(const std::string &isbn, std::string &username)
+{
+    auto queue = m_queues.find(isbn);
+    if (queue == m_queues.end())
+        return false;
+    username = queue->second.front();
+    return cancel(isbn, username);
+}
+
+void HoldQueue::removeBook(const std::string &isbn)
+{
+    std::string username;
+    while (popNext(isbn, username))
+    {
+    }
+}
+
+void HoldQueue::removeUser(const std::string &username)
+{
+    auto user = m_by_user.find(username);
+    if (user == m_by_user.end())
+        return;
+    std::vector<std::string> isbns;
+    for (const auto &hold : user->second)
+        isbns.push_back(hold.first);
+    for (const auto &isbn : isbns)
+        cancel(isbn, username);
+}
+
+size_t HoldQueue::waitingFor(const std::string &isbn) const
+{
+    auto queue = m_queues.find(isbn);
+    return queue == m_queues.end() ? 0 : queue->second.size();
+}
+
+std::string HoldQueue::serialize() const
+{
+    std::ostringstream output;
+    for (const auto &queue : m_queues)
+    {
+        for (const auto &username : queue.second)
+            output << queue.first << "," << username << "\n";
+    }
+    return output.str();
+}
+
+void HoldQueue::load(const std::string &contents)
+{
+    m_queues.clear();
+    m_by_user.clear();
+    m_total = 0;
+    std::istringstream input(contents);
+    std::string line;
+    while (std::getline(input, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        size_t comma = line.find(',');
+        if (comma == std::string::npos)
+            continue;
+        place(line.substr(0, comma), line.substr(comma + 1));
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef HOLDQUEUE_H
+#define HOLDQUEUE_H
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Waiting lists for checked-out books.
+// Each ISBN has a first-come-first-served queue of usernames, and each user has
+// an index of their holds pointing straight at their queue entries, so placing,
+// cancelling and handing over a hold are O(1) regardless of how many holds exist.
+class HoldQueue
+{
+public:
+    // Returns the user's position in the queue (1 = next), or 0 if they already hold this book.
+    size_t place(const std::string &isbn, const std::string &username);
+    bool cancel(const std::string &isbn, const std::string &username);
+    // Removes and returns the first user waiting for the book.
+    bool popNext(const std::string &isbn, std::string &username);
+
+    void removeBook(const std::string &isbn);
+    void removeUser(const std::string &username);
+
+    size_t waitingFor(const std::string &isbn) const;
+    size_t size() const { return m_total; }
+
+    // "isbn,username" lines in queue order.
+    std::string serialize() const;
+    void load(const std::string &contents);
+
+private:
+    using Queue = std::list<std::string>; // Usernames, front = next in line.
+
+    std::unordered_map<std::string, Queue> m_queues; // isbn -> queue
+    std::unordered_map<std::string, std::unordered_map<std::string, Queue::iterator>> m_by_user; // user -> isbn -> entry
+    size_t m_total = 0;
+};
+
+#endif // HOLDQUEUE_H
@@ -0,0 +1,113 @@
+#ifndef KWAYMERGE_H
+#define KWAYMERGE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Walks several individually sorted lists as one sorted sequence without
+// concatenating them. A min-heap holds the next item of every list, so each
+// step costs O(log k) for k lists. The cursor is just one offset per list, so
+// a pager can remember it per page and come back with seek(); previous()
+// steps back one item in O(k) without the heap.
+// `less` must be a total order over items of all lists (break ties by list).
+template <typename Less>
+class KWayMerge
+{
+public:
+    struct Item
+    {
+        uint32_t list = 0;
+        size_t index = 0; // Position within that list.
+    };
+
+    KWayMerge(std::vector<size_t> sizes, Less less)
+        : m_sizes(std::move(sizes)), m_offsets(m_sizes.size(), 0), m_less(less)
+    {
+    }
+
+    // Sets the next item of every list.
+    void seek(const std::vector<size_t> &offsets)
+    {
+        m_offsets = offsets;
+        m_heap_valid = false;
+    }
+    const std::vector<size_t> &offsets() const { return m_offsets; }
+
+    // Items before the cursor in the merged order.
+    size_t position() const
+    {
+        size_t total = 0;
+        for (size_t offset : m_offsets)
+            total += offset;
+        return total;
+    }
+
+    bool next(Item &item)
+    {
+        if (!m_heap_valid)
+            rebuildHeap();
+        if (m_heap.empty())
+            return false;
+        std::pop_heap(m_heap.begin(), m_heap.end(), greater());
+        item = m_heap.back();
+        m_heap.pop_back();
+        size_t following = ++m_offsets[item.list];
+        if (following < m_sizes[item.list])
+        {
+            m_heap.push_back({item.list, following});
+            std::push_heap(m_heap.begin(), m_heap.end(), greater());
+        }
+        return true;
+    }
+
+    // The item before the cursor is the greatest of the items just before each list's offset.
+    bool previous()
+    {
+        bool found = false;
+        Item last;
+        for (uint32_t list = 0; list < m_offsets.size(); ++list)
+        {
+            if (m_offsets[list] == 0)
+                continue;
+            Item candidate{list, m_offsets[list] - 1};
+            if (!found || m_less(last, candidate))
+                last = candidate;
+            found = true;
+        }
+        if (found)
+        {
+            m_offsets[last.list]--;
+            m_heap_valid = false;
+        }
+        return found;
+    }
+
+private:
+    auto greater() const
+    {
+        return [this](const Item &a, const Item &b)
+        { return m_less(b, a); };
+    }
+
+    void rebuildHeap()
+    {
+        m_heap.clear();
+        for (uint32_t list = 0; list < m_offsets.size(); ++list)
+        {
+            if (m_offsets[list] < m_sizes[list])
+                m_heap.push_back({list, m_offsets[list]});
+        }
+        std::make_heap(m_heap.begin(), m_heap.end(), greater());
+        m_heap_valid = true;
+    }
+
+    std::vector<size_t> m_sizes;
+    std::vector<size_t> m_offsets;
+    std::vector<Item> m_heap;
+    bool m_heap_valid = false;
+    Less m_less;
+};
+
+#endif // KWAYMERGE_H
@@ -0,0 +1,74 @@
+#include "KeyIndex.h"
+
+#include <algorithm>
+
+void KeyIndex::clear()
+{
+    m_first.clear();
+    m_more.clear();
+}
+
+void KeyIndex::add(const std::string &key, uint32_t id)
+{
+    auto first = m_first.emplace(key, id);
+    if (first.second)
+        return;
+    uint32_t &lowest = first.first->second;
+    if (id < lowest)
+        std::swap(id, lowest);
+    std::vector<uint32_t> &more = m_more[key];
+    more.insert(std::lower_bound(more.begin(), more.end(), id), id);
+}
+
+void KeyIndex::remove(const std::string &key, uint32_t id)
+{
+    auto first = m_first.find(key);
+    if (first == m_first.end())
+        return;
+    auto more = m_more.find(key);
+    if (first->second == id)
+    {
+        if (more == m_more.end())
+        {
+            m_first.erase(first);
+            return;
+        }
+        first->second = more->second.front();
+        more->second.erase(more->second.begin());
+    }
+    else if (more != m_more.end())
+    {
+        auto it = std::lower_bound(more->second.begin(), more->second.end(), id);
+        if (it == more->second.end() || *it != id)
+            return;
+        more->second.erase(it);
+    }
+    if (more != m_more.end() && more->second.empty())
+        m_more.erase(more);
+}
+
+uint32_t KeyIndex::find(const std::string &key, size_t occurrence) const
+{
+    auto first = m_first.find(key);
+    if (first == m_first.end())
+        return NONE;
+    if (occurrence == 0)
+        return first->second;
+    auto more = m_more.find(key);
+    if (more == m_more.end() || occurrence > more->second.size())
+        return NONE;
+    return more->second[occurrence - 1];
+}
+
+std::vector<uint32_t> KeyIndex::findAll(const std::string &key) const
+{
+    std::vector<uint32_t> ids;
+    auto first = m_first.find(key);
+    if (first == m_first.end())
+        return ids;
+    ids.push_back(first->second);
+    auto more = m_more.find(key);
+    if (more != m_more.end())
+        ids.insert(ids.end(), more->second.begin(), more->second.end());
+    return ids;
+}
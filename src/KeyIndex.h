@@ -0,0 +1,36 @@
+#ifndef KEYINDEX_H
+#define KEYINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Record key -> slot ids, for record stores whose keys may repeat (old books
+// files list an ISBN once per copy). A key's ids are kept in slot order, which
+// is the order the records are saved in, so find(key, n) is the record that a
+// three-way merge calls occurrence n of that key. Most keys have one record,
+// so the first id is kept inline and only repeated keys get a list.
+class KeyIndex
+{
+public:
+    static const uint32_t NONE = UINT32_MAX;
+
+    void clear();
+    void add(const std::string &key, uint32_t id);
+    void remove(const std::string &key, uint32_t id);
+
+    // The occurrence-th record with this key, or NONE.
+    uint32_t find(const std::string &key, size_t occurrence = 0) const;
+    // Every record with this key, in slot order.
+    std::vector<uint32_t> findAll(const std::string &key) const;
+
+    size_t size() const { return m_first.size(); }
+
+private:
+    std::unordered_map<std::string, uint32_t> m_first;             // Lowest slot id per key.
+    std::unordered_map<std::string, std::vector<uint32_t>> m_more; // The rest, ascending; repeated keys only.
+};
+
+#endif // KEYINDEX_H
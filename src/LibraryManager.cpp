@@ -6,121 +6,1327 @@
 #include <algorithm>
 #include <limits>
 #include <cmath>
+#include <map>
+#include <iterator>
+#include <optional>
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
+#include <thread>
 #include "tabulate/table.hpp"
 #include "colors.hpp"
+#include "Trace.h"
+#include "CatalogExporter.h"
+#include "AllocStats.h"
+#include "ParallelSort.h"
+#include "Csv.h"
+#include "BookCsv.h"
+#include "KWayMerge.h"
+
+namespace
+{
+    bool readWholeFile(const std::string &path, std::string &contents)
+    {
+        std::ifstream inputFile(path, std::ios::binary);
+        if (!inputFile.is_open())
+            return false;
+        std::ostringstream buffer;
+        buffer << inputFile.rdbuf();
+        contents = buffer.str();
+        return true;
+    }
+
+    void parseUsers(const std::string &contents, std::vector<User> &users)
+    {
+        std::vector<std::string> fields;
+        size_t offset = 0;
+        while (Csv::readRecord(contents, offset, fields))
+        {
+            if (Csv::isBlank(fields))
+                continue;
+            fields.resize(3);
+            UserRole role = (fields[2] == "0" ? UserRole::LIBRARIAN : UserRole::MEMBER);
+            users.emplace_back(fields[0], fields[1], role);
+        }
+    }
+
+    std::string formatUsers(const SlotMap<User> &users)
+    {
+        size_t estimate = 0;
+        for (const auto &user : users)
+            estimate += user.getUsername().size() + user.getPassword().size() + 8;
+        std::string output;
+        output.reserve(estimate);
+        for (const auto &user : users)
+        {
+            Csv::appendField(output, user.getUsername());
+            output += ',';
+            Csv::appendField(output, user.getPassword());
+            output += (user.getRole() == UserRole::LIBRARIAN) ? ",0\n" : ",1\n";
+        }
+        return output;
+    }
+
+    // Heading suffix for a ranked search that asked for one hit more than `limit`.
+    std::string resultCount(size_t found, size_t limit)
+    {
+        if (found > limit)
+            return "(the " + std::to_string(limit) + " most relevant of more than " + std::to_string(limit) + " found)";
+        return "(" + std::to_string(found) + " found, most relevant first)";
+    }
+
+    bool sameBook(const Book &a, const Book &b)
+    {
+        return a.isbn == b.isbn && a.title == b.title && a.author == b.author &&
+               a.isCheckedOut == b.isCheckedOut && a.borrowerUsername == b.borrowerUsername && a.dueDate == b.dueDate;
+    }
+
+    std::string formatDate(std::time_t when)
+    {
+        char date[16];
+        std::strftime(date, sizeof(date), "%Y-%m-%d", std::localtime(&when));
+        return date;
+    }
+
+    // Reads a line of ISBNs separated by spaces and/or commas.
+    std::vector<std::string> readIsbnList()
+    {
+        std::string line;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        std::getline(std::cin, line);
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::stringstream ss(line);
+        std::vector<std::string> isbns;
+        std::string isbn;
+        while (ss >> isbn)
+            isbns.push_back(isbn);
+        return isbns;
+    }
+
+    std::string formatBytes(int64_t bytes)
+    {
+        if (bytes < 10 * 1024)
+            return std::to_string(bytes) + " B";
+        if (bytes < 10 * 1024 * 1024)
+            return std::to_string(bytes / 1024) + " KiB";
+        return std::to_string(bytes / (1024 * 1024)) + " MiB";
+    }
+
+    const std::time_t LOAN_PERIOD_SECONDS = 14 * 24 * 60 * 60;
+
+    std::string statusText(const Book &book)
+    {
+        if (!book.isCheckedOut)
+            return "Available";
+        std::string text = "Checked Out by: " + book.borrowerUsername;
+        if (book.dueDate != 0)
+            text += " (due " + formatDate(book.dueDate) + ")";
+        return text;
+    }
+
+    bool sameUser(const User &a, const User &b)
+    {
+        return a.getUsername() == b.getUsername() && a.getPassword() == b.getPassword() && a.getRole() == b.getRole();
+    }
+
+    // mergeRecords' view of a plain SlotMap, with a key index built up front so
+    // each lookup is O(1) rather than a scan.
+    template <typename Record, typename KeyOf>
+    class SlotMapTable
+    {
+    public:
+        SlotMapTable(SlotMap<Record> &records, KeyOf keyOf) : m_records(records), m_key_of(keyOf)
+        {
+            for (auto it = m_records.begin(); it != m_records.end(); ++it)
+                m_index.add(m_key_of(*it), it.index());
+        }
+
+        uint32_t locate(const std::string &key, int occurrence) const { return m_index.find(key, occurrence); }
+        const Record &get(uint32_t id) const { return m_records[id]; }
+        void update(uint32_t id, const Record &record) { m_records[id] = record; }
+        void insert(const Record &record) { m_index.add(m_key_of(record), m_records.insert(record).index); }
+        void erase(uint32_t id)
+        {
+            m_index.remove(m_key_of(m_records[id]), id);
+            m_records.erase(m_records.handleAt(id));
+        }
+
+    private:
+        SlotMap<Record> &m_records;
+        KeyOf m_key_of;
+        KeyIndex m_index;
+    };
+
+    template <typename Record, typename KeyOf>
+    SlotMapTable<Record, KeyOf> slotMapTable(SlotMap<Record> &records, KeyOf keyOf)
+    {
+        return SlotMapTable<Record, KeyOf>(records, keyOf);
+    }
+
+    int64_t nowMicros()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // One record that differs between two versions of a list, matched by key and occurrence.
+    template <typename Record>
+    struct RecordChange
+    {
+        std::pair<std::string, int> key;
+        const Record *before; // In the old list; null if the record was added.
+        const Record *after;  // In the new list; null if it was removed.
+    };
+
+    // Added and changed records in key order, then removed ones, highest
+    // occurrence first so earlier occurrences keep their numbers while the
+    // removals are applied. The pointers are into `base` and `theirs`.
+    template <typename Record, typename KeyOf, typename Same>
+    std::vector<RecordChange<Record>> diffRecords(const std::vector<Record> &base, const std::vector<Record> &theirs,
+                                                  KeyOf keyOf, Same same)
+    {
+        using Key = std::pair<std::string, int>;
+        auto index = [&](const std::vector<Record> &list)
+        {
+            std::map<Key, const Record *> keyed;
+            std::map<std::string, int> seen;
+            for (const auto &record : list)
+            {
+                std::string key = keyOf(record);
+                keyed[{key, seen[key]++}] = &record;
+            }
+            return keyed;
+        };
+        std::map<Key, const Record *> base_keyed = index(base);
+        std::map<Key, const Record *> their_keyed = index(theirs);
+
+        std::vector<RecordChange<Record>> changes;
+        for (const auto &entry : their_keyed)
+        {
+            auto previous = base_keyed.find(entry.first);
+            if (previous == base_keyed.end())
+                changes.push_back({entry.first, nullptr, entry.second});
+            else if (!same(*previous->second, *entry.second))
+                changes.push_back({entry.first, previous->second, entry.second});
+        }
+        size_t first_removal = changes.size();
+        for (const auto &entry : base_keyed)
+        {
+            if (their_keyed.find(entry.first) == their_keyed.end())
+                changes.push_back({entry.first, entry.second, nullptr});
+        }
+        std::sort(changes.begin() + first_removal, changes.end(), [](const RecordChange<Record> &a, const RecordChange<Record> &b)
+                  { return a.key.second > b.key.second; });
+        return changes;
+    }
+
+    // Applies `changes` (from diffRecords) to `table`, which provides
+    // locate(key, occurrence) (KeyIndex::NONE if absent), get(id), update(id, record),
+    // insert(record) and erase(id), so the cost is O(changes) lookups.
+    // Returns the keys of every record that was touched.
+    // With `conflicts`, a record that `table` itself changed since the old list is
+    // left alone (first writer wins) and its key is reported there instead.
+    template <typename Record, typename Table, typename Same>
+    std::vector<std::string> applyChanges(Table &table, const std::vector<RecordChange<Record>> &changes, Same same,
+                                          std::vector<std::string> *conflicts = nullptr)
+    {
+        // get() may return a copy (the catalog fills in titles), so it is kept here.
+        std::optional<Record> current;
+        std::vector<std::string> touched;
+        for (const auto &change : changes)
+        {
+            uint32_t id = table.locate(change.key.first, change.key.second);
+            const Record *existing = nullptr;
+            if (id != KeyIndex::NONE)
+            {
+                current.emplace(table.get(id));
+                existing = &*current;
+            }
+            if (conflicts != nullptr)
+            {
+                bool changed_since = change.before == nullptr ? existing != nullptr
+                                                              : existing == nullptr || !same(*existing, *change.before);
+                if (changed_since)
+                {
+                    if (change.after == nullptr ? existing != nullptr : existing == nullptr || !same(*existing, *change.after))
+                        conflicts->push_back(change.key.first);
+                    continue;
+                }
+            }
+            if (change.after == nullptr)
+            {
+                if (existing != nullptr)
+                    table.erase(id);
+            }
+            else if (existing != nullptr)
+            {
+                table.update(id, *change.after);
+            }
+            else
+            {
+                table.insert(*change.after);
+            }
+            touched.push_back(change.key.first);
+        }
+        return touched;
+    }
+
+    // Three-way merge of a data file edited by another program.
+    // `base` is what we last read or wrote, `theirs` is the file now. Only the
+    // records that differ between the two are applied to `table`, so changes
+    // made in memory since the last write are kept. Records are matched by key
+    // and occurrence number (old files contain repeated ISBNs).
+    template <typename Record, typename Table, typename KeyOf, typename Same>
+    std::vector<std::string> mergeRecords(Table &table, const std::vector<Record> &base,
+                                          const std::vector<Record> &theirs, KeyOf keyOf, Same same)
+    {
+        return applyChanges(table, diffRecords(base, theirs, keyOf, same), same);
+    }
+}
+
+// Constructor: Loads all data when the program starts.
+LibraryManager::LibraryManager(const std::string &books_path, const std::string &users_path, const std::string &holds_path,
+                               bool load_books)
+{
+    m_books_filepath = books_path;
+    m_users_filepath = users_path;
+    m_holds_filepath = holds_path;
+    if (load_books)
+        loadBooks();
+    loadUsers();
+    loadHolds();
+    m_watcher.watch({m_books_filepath, m_users_filepath});
+}
+
+// --- Record Layer ---
+
+struct LibraryManager::CatalogTable
+{
+    LibraryManager &library;
+
+    uint32_t locate(const std::string &isbn, int occurrence) const { return library.m_isbn_index.find(isbn, occurrence); }
+    Book get(uint32_t id) const { return library.bookAt(id); }
+    void update(uint32_t id, const Book &book) { library.updateBook(id, book); }
+    void insert(const Book &book) { library.insertBook(book); }
+    void erase(uint32_t id) { library.eraseBook(id); }
+};
+
+// With a shared catalog the segment assigns the copy id, so two desks adding
+// the same ISBN get different ones.
+uint32_t LibraryManager::insertBook(const Book &book, bool assign_copy_id)
+{
+    Book after = book;
+    if (m_shared_catalog.isOpen())
+    {
+        std::vector<SharedCatalog::Edit> edits{{SharedCatalog::Edit::Kind::INSERT, Book(), book}};
+        if (!publishToSharedCatalog(edits))
+            return KeyIndex::NONE;
+        after = edits.front().after;
+    }
+    else if (assign_copy_id)
+    {
+        after.copyId = 0;
+        for (uint32_t other : m_isbn_index.findAll(book.isbn))
+            after.copyId = std::max(after.copyId, m_books[other].copyId + 1);
+    }
+    uint32_t id = m_books.insert(Book()).index;
+    storeBook(id, after);
+    m_title_dictionary.set(id, book.title);
+    noteBookChange(id, nullptr, &after);
+    return id;
+}
+
+bool LibraryManager::updateBook(uint32_t id, const Book &book, const Book *expected)
+{
+    return updateBooks({id}, {book}, {expected != nullptr ? *expected : bookAt(id)});
+}
+
+// Keeps each record's copy id: `books` usually come from a file, which has none.
+bool LibraryManager::updateBooks(const std::vector<uint32_t> &ids, const std::vector<Book> &books, const std::vector<Book> &expected)
+{
+    std::vector<Book> before, after = books;
+    before.reserve(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        before.push_back(bookAt(ids[i]));
+        after[i].copyId = before[i].copyId;
+    }
+    if (m_shared_catalog.isOpen())
+    {
+        std::vector<SharedCatalog::Edit> edits;
+        for (size_t i = 0; i < ids.size(); ++i)
+            edits.push_back({SharedCatalog::Edit::Kind::REPLACE, expected[i], after[i]});
+        if (!publishToSharedCatalog(edits))
+            return false;
+    }
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        if (m_page_store.isOpen() && after[i].isbn != before[i].isbn)
+            m_page_store.erase(before[i].isbn, before[i].copyId);
+        storeBook(ids[i], after[i]);
+        if (after[i].title != before[i].title)
+            m_title_dictionary.set(ids[i], after[i].title);
+        noteBookChange(ids[i], &before[i], &after[i]);
+    }
+    return true;
+}
+
+bool LibraryManager::eraseBook(uint32_t id)
+{
+    Book before = bookAt(id);
+    if (m_shared_catalog.isOpen())
+    {
+        std::vector<SharedCatalog::Edit> edits{{SharedCatalog::Edit::Kind::ERASE, before, Book()}};
+        if (!publishToSharedCatalog(edits))
+            return false;
+    }
+    if (m_page_store.isOpen())
+        m_page_store.erase(before.isbn, before.copyId);
+    m_books.erase(m_books.handleAt(id));
+    m_title_dictionary.erase(id);
+    noteBookChange(id, &before, nullptr);
+    return true;
+}
+
+// Record `id` keeps everything but the title, or only the key if the page store
+// or the shared catalog holds the record (a shared change is already published).
+void LibraryManager::storeBook(uint32_t id, const Book &book)
+{
+    Book &record = m_books[id];
+    if (!recordsEvicted())
+    {
+        record = book;
+        record.title.clear();
+        return;
+    }
+    record = Book();
+    record.isbn = book.isbn;
+    record.copyId = book.copyId;
+    if (m_page_store.isOpen() && !m_page_store.put(book))
+    {
+        std::cerr << Color::BOLD_RED << "ERROR: Could not update book " << book.isbn << " in the page store." << Color::RESET << std::endl;
+    }
+}
+
+void LibraryManager::evictBooks()
+{
+    for (auto &record : m_books)
+    {
+        Book key;
+        key.isbn = std::move(record.isbn);
+        key.copyId = record.copyId;
+        record = std::move(key);
+    }
+}
+
+std::string LibraryManager::bookTitle(uint32_t id) const
+{
+    return m_title_dictionary.title(id);
+}
+
+Book LibraryManager::bookAt(uint32_t id) const
+{
+    Book book;
+    if (recordsEvicted())
+    {
+        bookFields(id, book); // The stored record has its title.
+        return book;
+    }
+    book = m_books[id];
+    m_title_dictionary.title(id, book.title);
+    return book;
+}
+
+// A record another desk has just removed from the shared catalog reads as its
+// bare key until the next refresh drops it; a change to it is refused as a conflict.
+const Book &LibraryManager::bookFields(uint32_t id, Book &buffer) const
+{
+    const Book &record = m_books[id];
+    if (!recordsEvicted())
+        return record;
+    if (m_shared_catalog.isOpen())
+    {
+        if (!m_shared_catalog.find(record.isbn, record.copyId, buffer))
+            buffer = record;
+    }
+    else if (!m_page_store.find(record.isbn, record.copyId, buffer))
+    {
+        std::cerr << Color::BOLD_RED << "ERROR: Book " << record.isbn << " could not be read from the page store." << Color::RESET << std::endl;
+        buffer = record;
+    }
+    return buffer;
+}
+
+uint32_t LibraryManager::locateBook(const std::string &isbn, int copy_id) const
+{
+    for (uint32_t id : m_isbn_index.findAll(isbn))
+    {
+        if (m_books[id].copyId == copy_id)
+            return id;
+    }
+    return KeyIndex::NONE;
+}
+
+std::vector<Book> LibraryManager::catalogBooks() const
+{
+    std::vector<Book> books;
+    books.reserve(m_books.size());
+    for (auto it = m_books.begin(); it != m_books.end(); ++it)
+        books.push_back(bookAt(it.index()));
+    return books;
+}
+
+// Like BookCsv::format, with each title decoded into one reused buffer.
+std::string LibraryManager::formatCatalog() const
+{
+    size_t estimate = m_title_dictionary.rawBytes();
+    for (const auto &book : m_books)
+        estimate += book.isbn.size() + book.author.size() + book.borrowerUsername.size() + 32;
+    std::string output;
+    output.reserve(estimate);
+    std::string title;
+    Book buffer;
+    for (auto it = m_books.begin(); it != m_books.end(); ++it)
+    {
+        m_title_dictionary.title(it.index(), title);
+        BookCsv::appendRow(output, bookFields(it.index(), buffer), title);
+    }
+    return output;
+}
+
+void LibraryManager::noteBookChange(uint32_t id, const Book *before, const Book *after)
+{
+    if (before == nullptr || after == nullptr || before->isbn != after->isbn)
+    {
+        if (before != nullptr)
+            m_isbn_index.remove(before->isbn, id);
+        if (after != nullptr)
+            m_isbn_index.add(after->isbn, id);
+    }
+    if (after != nullptr && after->isCheckedOut && after->dueDate != 0)
+        m_loans.track(id, after->dueDate);
+    else
+        m_loans.untrack(id);
+
+    // Which indexes were current before this change; only those are patched; the
+    // others are rebuilt from scratch when next used anyway.
+    const bool text_changed = before == nullptr || after == nullptr || before->title != after->title || before->author != after->author;
+    const bool facets_current = m_facets_catalog_generation == m_catalog_generation &&
+                                m_facets_circulation_generation == m_circulation_generation;
+    const bool fuzzy_current = m_fuzzy_index_generation == m_catalog_generation;
+    const bool text_current = m_text_index_generation == m_catalog_generation;
+    bool views_current[static_cast<size_t>(BookSortKey::COUNT)];
+    for (size_t key = 0; key < static_cast<size_t>(BookSortKey::COUNT); ++key)
+    {
+        const SortedView &view = m_book_views[key];
+        views_current[key] = view.catalog_generation == m_catalog_generation &&
+                             (!sortUsesCirculation(static_cast<BookSortKey>(key)) || view.circulation_generation == m_circulation_generation);
+    }
+    if (text_changed)
+        m_catalog_generation++;
+    else
+        m_circulation_generation++;
+
+    if (facets_current)
+    {
+        AllocScope alloc_scope(AllocStats::Subsystem::FACET_INDEX);
+        if (before != nullptr)
+            m_facets.remove(id, *before);
+        if (after != nullptr)
+            m_facets.add(id, *after);
+        m_facets_catalog_generation = m_catalog_generation;
+        m_facets_circulation_generation = m_circulation_generation;
+    }
+    if (text_changed && fuzzy_current)
+    {
+        AllocScope alloc_scope(AllocStats::Subsystem::FUZZY_INDEX);
+        if (before != nullptr)
+            m_fuzzy_index.removeDocument(id, before->title + " " + before->author);
+        if (after != nullptr)
+            m_fuzzy_index.addDocument(id, after->title + " " + after->author);
+    }
+    if (fuzzy_current)
+        m_fuzzy_index_generation = m_catalog_generation;
+    if (text_changed && text_current)
+    {
+        AllocScope alloc_scope(AllocStats::Subsystem::TEXT_INDEX);
+        if (before != nullptr)
+            m_text_index.removeDocument(id, before->title + " " + before->author);
+        if (after != nullptr)
+            m_text_index.addDocument(id, after->title + " " + after->author);
+    }
+    if (text_current)
+        m_text_index_generation = m_catalog_generation;
+
+    // Sorted views: take the book out and put it back where its new values go.
+    AllocScope alloc_scope(AllocStats::Subsystem::DISPLAY);
+    for (size_t key = 0; key < static_cast<size_t>(BookSortKey::COUNT); ++key)
+    {
+        if (!views_current[key])
+            continue;
+        SortedView &view = m_book_views[key];
+        const BookSortKey sort_key = static_cast<BookSortKey>(key);
+        if (text_changed || sortUsesCirculation(sort_key))
+        {
+            auto old_pos = std::find(view.ids.begin(), view.ids.end(), id);
+            if (before != nullptr && old_pos != view.ids.end())
+                view.ids.erase(old_pos);
+            if (after != nullptr)
+            {
+                Book buffer;
+                auto pos = std::lower_bound(view.ids.begin(), view.ids.end(), id, [&](uint32_t a, uint32_t b)
+                                            { return booksInOrder(sort_key, a, bookFields(a, buffer), b, *after); });
+                view.ids.insert(pos, id);
+            }
+        }
+        view.catalog_generation = m_catalog_generation;
+        view.circulation_generation = m_circulation_generation;
+    }
+
+    if (m_replication_server.isRunning())
+    {
+        if (after == nullptr || (before != nullptr && before->isbn != after->isbn))
+            journalBookChange(ReplicationEvent::Kind::REMOVE, *before);
+        if (after != nullptr && (before == nullptr || before->isbn != after->isbn))
+            journalBookChange(ReplicationEvent::Kind::ADD, *after);
+        else if (after != nullptr)
+        {
+            journalBookChange(!before->isCheckedOut && after->isCheckedOut   ? ReplicationEvent::Kind::CHECKOUT
+                              : before->isCheckedOut && !after->isCheckedOut ? ReplicationEvent::Kind::RETURN
+                                                                             : ReplicationEvent::Kind::UPDATE,
+                              *after);
+        }
+    }
+}
+
+// --- File I/O ---
+
+void LibraryManager::loadBooks()
+{
+    TraceSpan span("loadBooks");
+    AllocScope alloc_scope(AllocStats::Subsystem::CATALOG);
+    m_books_loaded = true;
+    uint64_t allocations_before = AllocStats::counters(AllocStats::Subsystem::CATALOG).allocations;
+    std::string contents;
+    if (!readWholeFile(m_books_filepath, contents))
+    {
+        std::cerr << Color::BOLD_RED << "ERROR: Could not open books data file: " << m_books_filepath << Color::RESET << std::endl;
+        return;
+    }
+    std::vector<Book> books;
+    BookCsv::parse(contents, books);
+    m_books.clear();
+    for (auto &book : books)
+        m_books.insert(std::move(book));
+    m_books_load_allocations = AllocStats::counters(AllocStats::Subsystem::CATALOG).allocations - allocations_before;
+    reindexBooks();
+    m_writer.noteOnDisk(m_books_filepath, contents);
+}
+
+void LibraryManager::saveBooks()
+{
+    TraceSpan span("saveBooks");
+    if (recordsEvicted())
+    {
+        // The change is already in the page store or the shared catalog; the books
+        // file gets it on the next export (flushPendingWrites).
+        shipJournal();
+        if (m_page_store.isOpen() && (!m_page_store.setUnexportedChanges(true) || !m_page_store.flush()))
+            std::cerr << Color::BOLD_RED << "ERROR: Could not flush the page store." << Color::RESET << std::endl;
+        return;
+    }
+    shipJournal();
+    m_writer.submit(m_books_filepath, formatCatalog());
+}
+
+void LibraryManager::loadUsers()
+{
+    TraceSpan span("loadUsers");
+    AllocScope alloc_scope(AllocStats::Subsystem::USERS);
+    std::string contents;
+    if (!readWholeFile(m_users_filepath, contents))
+    {
+        std::cerr << Color::BOLD_RED << "ERROR: Could not open users data file: " << m_users_filepath << Color::RESET << std::endl;
+        return;
+    }
+    std::vector<User> users;
+    parseUsers(contents, users);
+    m_users.clear();
+    for (auto &user : users)
+        m_users.insert(std::move(user));
+    m_users_generation++;
+    m_writer.noteOnDisk(m_users_filepath, contents);
+}
+
+void LibraryManager::saveUsers()
+{
+    TraceSpan span("saveUsers");
+    m_writer.submit(m_users_filepath, formatUsers(m_users));
+}
+
+// The holds file is optional: a missing file just means nobody is waiting.
+void LibraryManager::loadHolds()
+{
+    AllocScope alloc_scope(AllocStats::Subsystem::HOLDS_AND_LOANS);
+    std::string contents;
+    if (readWholeFile(m_holds_filepath, contents))
+        m_holds.load(contents);
+}
+
+void LibraryManager::saveHolds()
+{
+    m_writer.submit(m_holds_filepath, m_holds.serialize());
+}
+
+// Applies edits other programs made to the data files since we last looked.
+void LibraryManager::pollDataFiles()
+{
+    refreshFromSharedCatalog();
+    applyReplicationEvents();
+    for (const auto &path : m_watcher.poll())
+    {
+        // With a shared catalog or as a replica, book changes arrive through the segment or the stream instead.
+        if (path == m_books_filepath && !m_shared_catalog.isOpen() && !isReplica())
+            mergeExternalBooks();
+        else if (path == m_users_filepath)
+            mergeExternalUsers();
+        for (auto &branch : m_branches)
+        {
+            if (path == branch->booksPath())
+                reloadBranch(*branch);
+        }
+    }
+}
+
+void LibraryManager::mergeExternalBooks()
+{
+    TraceSpan span("mergeExternalBooks");
+    AllocScope alloc_scope(AllocStats::Subsystem::CATALOG);
+    std::string current;
+    if (!readWholeFile(m_books_filepath, current))
+        return;
+    if (m_writer.isOwnWrite(m_books_filepath, current))
+        return;
+    std::string base = m_writer.lastOnDisk(m_books_filepath);
+
+    std::vector<Book> base_books, their_books;
+    BookCsv::parse(base, base_books);
+    BookCsv::parse(current, their_books);
+    CatalogTable table{*this};
+    std::vector<std::string> touched = mergeRecords(table, base_books, their_books, [](const Book &book)
+                                                    { return book.isbn; }, sameBook);
+    m_writer.noteOnDisk(m_books_filepath, current);
+
+    applyBookChanges(touched);
+    if (!touched.empty())
+    {
+        std::cout << Color::YELLOW << "Reloaded " << touched.size() << " changed book record(s) from " << m_books_filepath << "." << Color::RESET << std::endl;
+    }
+
+    // If we had unsaved changes of our own, write the merged result back.
+    if (formatCatalog() != current)
+        saveBooks();
+}
+
+// Holds on books that are gone for good are dropped; the indexes were already
+// patched record by record as the merge applied each change.
+void LibraryManager::applyBookChanges(const std::vector<std::string> &touched)
+{
+    if (touched.empty())
+        return;
+    bool holds_changed = false;
+    for (const auto &isbn : touched)
+    {
+        if (m_isbn_index.find(isbn) == KeyIndex::NONE && m_holds.waitingFor(isbn) > 0)
+        {
+            m_holds.removeBook(isbn);
+            holds_changed = true;
+        }
+    }
+    if (holds_changed)
+        saveHolds();
+    shipJournal();
+}
+
+void LibraryManager::mergeExternalUsers()
+{
+    TraceSpan span("mergeExternalUsers");
+    AllocScope alloc_scope(AllocStats::Subsystem::USERS);
+    std::string current;
+    if (!readWholeFile(m_users_filepath, current))
+        return;
+    if (m_writer.isOwnWrite(m_users_filepath, current))
+        return;
+    std::string base = m_writer.lastOnDisk(m_users_filepath);
+
+    std::vector<User> base_users, their_users;
+    parseUsers(base, base_users);
+    parseUsers(current, their_users);
+    auto table = slotMapTable(m_users, [](const User &user)
+                              { return user.getUsername(); });
+    std::vector<std::string> touched = mergeRecords(table, base_users, their_users, [](const User &user)
+                                                    { return user.getUsername(); }, sameUser);
+    m_writer.noteOnDisk(m_users_filepath, current);
+
+    if (!touched.empty())
+    {
+        m_users_generation++;
+        std::cout << Color::YELLOW << "Reloaded " << touched.size() << " changed user record(s) from " << m_users_filepath << "." << Color::RESET << std::endl;
+    }
+    if (formatUsers(m_users) != current)
+        saveUsers();
+}
+
+// Blocks until every queued save has reached the disk. With the page store or
+// the shared catalog holding the records, this is also where the books file is
+// exported from them.
+bool LibraryManager::flushPendingWrites()
+{
+    const bool exporting = m_books_unexported || (m_page_store.isOpen() && m_page_store.hasUnexportedChanges());
+    if (exporting)
+    {
+        refreshFromSharedCatalog(); // The export includes what other desks changed.
+        m_writer.submit(m_books_filepath, formatCatalog());
+    }
+    bool ok = m_writer.flush();
+    if (!ok)
+    {
+        std::cerr << Color::BOLD_RED << "ERROR: Some changes could not be saved to the data files. They are kept and will be retried."
+                  << Color::RESET << std::endl;
+    }
+    if (exporting && ok)
+    {
+        m_books_unexported = false;
+        if (m_page_store.isOpen())
+            m_page_store.setUnexportedChanges(false);
+    }
+    if (m_page_store.isOpen() && !m_page_store.flush())
+    {
+        std::cerr << Color::BOLD_RED << "ERROR: Could not flush the page store." << Color::RESET << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+bool LibraryManager::enablePageStore(const std::string &path, size_t pool_pages)
+{
+    TraceSpan span("enablePageStore");
+    AllocScope alloc_scope(AllocStats::Subsystem::CATALOG);
+    // A record the store cannot hold would be missing from it for good, so refuse instead.
+    size_t too_long = 0;
+    for (auto it = m_books.begin(); it != m_books.end(); ++it)
+    {
+        if (!BookPageStore::fits(bookAt(it.index())))
+            too_long++;
+    }
+    if (too_long > 0)
+    {
+        std::cerr << Color::BOLD_RED << "ERROR: " << too_long << " book(s) in " << m_books_filepath
+                  << " have fields too long for the page store; it was not enabled." << Color::RESET << std::endl;
+        return false;
+    }
+    if (!m_page_store.open(path, pool_pages))
+    {
+        std::cerr << Color::BOLD_RED << "ERROR: Could not open page store: " << path << Color::RESET << std::endl;
+        return false;
+    }
+
+    if (m_page_store.hasUnexportedChanges())
+    {
+        // The last session stopped before exporting: the store is newer than the
+        // books file, so the catalog is taken from it (copy ids and all) instead.
+        m_books.clear();
+        m_page_store.forEach([this](const Book &book)
+                             { m_books.insert(book); });
+        reindexBooks(false);
+        evictBooks();
+        m_writer.submit(m_books_filepath, formatCatalog());
+        if (m_writer.flush())
+            m_page_store.setUnexportedChanges(false);
+        std::cout << Color::YELLOW << "Restored " << m_books.size() << " book record(s) from page store " << path
+                  << "; it had changes " << m_books_filepath << " did not." << Color::RESET << std::endl;
+        return true;
+    }
+
+    // The books file was exported from the store when it was last closed, but it
+    // may have been edited since: bring the store in line with it, one record per copy.
+    std::vector<std::pair<std::string, int>> stale;
+    auto collectStale = [&](const Book &stored)
+    {
+        if (locateBook(stored.isbn, stored.copyId) == KeyIndex::NONE)
+            stale.emplace_back(stored.isbn, stored.copyId);
+    };
+    m_page_store.forEach(collectStale);
+    for (const auto &key : stale)
+        m_page_store.erase(key.first, key.second);
+
+    size_t written = 0;
+    Book book, stored;
+    for (auto it = m_books.begin(); it != m_books.end(); ++it)
+    {
+        book = *it;
+        m_title_dictionary.title(it.index(), book.title);
+        if (m_page_store.find(book.isbn, book.copyId, stored) && sameBook(stored, book))
+            continue;
+        if (!m_page_store.put(book))
+        {
+            std::cerr << Color::BOLD_RED << "ERROR: Could not write book " << book.isbn << " to the page store." << Color::RESET << std::endl;
+            m_page_store.close();
+            return false;
+        }
+        written++;
+    }
+    if (!m_page_store.flush())
+    {
+        std::cerr << Color::BOLD_RED << "ERROR: Could not flush the page store." << Color::RESET << std::endl;
+        m_page_store.close();
+        return false;
+    }
+    if (written > 0 || !stale.empty())
+    {
+        std::cout << Color::YELLOW << "Page store updated from " << m_books_filepath << ": " << written << " record(s) written, "
+                  << stale.size() << " removed." << Color::RESET << std::endl;
+    }
+    // From here on the store holds the records.
+    evictBooks();
+    return true;
+}
+
+void LibraryManager::reindexBooks(bool number_copies)
+{
+    m_catalog_generation++;
+    m_circulation_generation++;
+    {
+        // One sort at load; after that the dictionary is kept in order as titles change.
+        AllocScope alloc_scope(AllocStats::Subsystem::TITLE_DICTIONARY);
+        std::vector<uint32_t> order;
+        order.reserve(m_books.size());
+        for (auto it = m_books.begin(); it != m_books.end(); ++it)
+            order.push_back(it.index());
+        parallelStableSort(order, [this](uint32_t a, uint32_t b)
+                           {
+                               int compared = m_books[a].title.compare(m_books[b].title);
+                               return compared != 0 ? compared < 0 : a < b;
+                           });
+        m_title_dictionary.clear();
+        for (uint32_t id : order)
+        {
+            m_title_dictionary.add(m_books[id].title, id);
+            std::string().swap(m_books[id].title);
+        }
+    }
+
+    // Copies of an ISBN are numbered in file order.
+    m_isbn_index.clear();
+    for (auto it = m_books.begin(); it != m_books.end(); ++it)
+    {
+        if (number_copies)
+            it->copyId = static_cast<int>(m_isbn_index.findAll(it->isbn).size());
+        m_isbn_index.add(it->isbn, it.index());
+    }
+
+    AllocScope alloc_scope(AllocStats::Subsystem::HOLDS_AND_LOANS);
+    m_loans.clear();
+    for (auto it = m_books.begin(); it != m_books.end(); ++it)
+    {
+        // Loans recorded before due dates existed have none; they never show as overdue.
+        if (it->isCheckedOut && it->dueDate != 0)
+            m_loans.track(it.index(), it->dueDate);
+    }
+}
+
+// --- Shared Catalog ---
+// The segment holds the only copy of the records; m_books keeps each record's
+// key, and the title dictionary, ISBN index and loans stay per process because
+// every lookup goes through them. Each record-layer change is published as an
+// edit under the segment's writer lock, and other desks' changes are picked up
+// from its change log record by record.
+
+bool LibraryManager::enableSharedCatalog(const std::string &name, size_t capacity)
+{
+    TraceSpan span("enableSharedCatalog");
+    if (m_page_store.isOpen())
+    {
+        std::cerr << Color::BOLD_RED << "ERROR: The shared catalog cannot be used together with the page store." << Color::RESET << std::endl;
+        return false;
+    }
+    if (m_shared_catalog.attach(name))
+    {
+        if (!resyncFromSharedCatalog())
+        {
+            m_shared_catalog.close();
+            return false;
+        }
+        std::cout << Color::YELLOW << "Attached to shared catalog " << name << " (" << m_books.size() << " books)." << Color::RESET << std::endl;
+        return true;
+    }
+
+    // We are the first desk: the segment is seeded from the books file.
+    if (!m_books_loaded)
+        loadBooks();
+    // Checked before the segment exists, so a catalog that cannot be shared is never half shared.
+    std::vector<Book> books = catalogBooks();
+    size_t too_long = std::count_if(books.begin(), books.end(), [](const Book &book)
+                                    { return !SharedCatalog::fits(book); });
+    if (too_long > 0)
+    {
+        std::cerr << Color::BOLD_RED << "ERROR: " << too_long << " books have a field too long for the shared catalog; it was not enabled."
+                  << Color::RESET << std::endl;
+        return false;
+    }
+    if (books.size() > capacity)
+    {
+        std::cerr << Color::BOLD_RED << "ERROR: The shared catalog holds " << capacity << " books but " << books.size()
+                  << " are loaded; it was not enabled." << Color::RESET << std::endl;
+        return false;
+    }
+
+    bool exists = false;
+    if (!m_shared_catalog.create(name, capacity, books, exists))
+    {
+        // Another desk created it in the meantime: its records win over our file load.
+        if (exists && m_shared_catalog.attach(name))
+        {
+            if (!resyncFromSharedCatalog())
+            {
+                m_shared_catalog.close();
+                return false;
+            }
+            std::cout << Color::YELLOW << "Attached to shared catalog " << name << " (" << m_books.size() << " books)." << Color::RESET << std::endl;
+            return true;
+        }
+        std::cerr << Color::BOLD_RED << "ERROR: Could not open shared catalog: " << name << Color::RESET << std::endl;
+        return false;
+    }
+    evictBooks();
+    std::cout << Color::YELLOW << "Created shared catalog " << name << " with " << m_books.size() << " books." << Color::RESET << std::endl;
+    return true;
+}
+
+bool LibraryManager::resyncFromSharedCatalog()
+{
+    TraceSpan span("resyncFromSharedCatalog");
+    AllocScope alloc_scope(AllocStats::Subsystem::CATALOG);
+    std::vector<Book> books;
+    if (!m_shared_catalog.read(books))
+    {
+        std::cerr << Color::BOLD_RED << "ERROR: Could not read the shared catalog." << Color::RESET << std::endl;
+        return false;
+    }
+    m_books.clear();
+    for (auto &book : books)
+        m_books.insert(std::move(book));
+    m_books_loaded = true;
+    // The segment assigned the copy ids; they are the keys other desks use too.
+    reindexBooks(false);
+    evictBooks();
+    if (m_replication_server.isRunning())
+    {
+        // Replicas replace their catalog too; the journal so far is part of it.
+        m_journal.clear();
+        ReplicationEvent snapshot;
+        snapshot.kind = ReplicationEvent::Kind::SNAPSHOT;
+        snapshot.record = formatSnapshot();
+        m_replication_server.ship({std::move(snapshot)});
+    }
+    return true;
+}
+
+void LibraryManager::refreshFromSharedCatalog()
+{
+    if (!m_shared_catalog.isOpen())
+        return;
+    std::vector<SharedCatalog::Change> changes;
+    if (!m_shared_catalog.changes(changes))
+    {
+        // More changed than the log holds.
+        resyncFromSharedCatalog();
+        return;
+    }
+    applySharedChanges(changes);
+}
+
+void LibraryManager::applySharedChanges(const std::vector<SharedCatalog::Change> &changes)
+{
+    if (changes.empty())
+        return;
+    TraceSpan span("applySharedChanges");
+    AllocScope alloc_scope(AllocStats::Subsystem::CATALOG);
+    bool text_changed = false;
+    std::vector<std::string> touched;
+    for (const auto &change : changes)
+    {
+        const Book &book = change.book;
+        uint32_t id = locateBook(book.isbn, book.copyId);
+        touched.push_back(book.isbn);
+        if (!change.present)
+        {
+            if (id == KeyIndex::NONE)
+                continue;
+            m_isbn_index.remove(book.isbn, id);
+            m_loans.untrack(id);
+            m_title_dictionary.erase(id);
+            m_books.erase(m_books.handleAt(id));
+            text_changed = true;
+            if (m_replication_server.isRunning())
+                journalBookChange(ReplicationEvent::Kind::REMOVE, book);
+            continue;
+        }
+        // The record before the change is gone, so a circulation change is told
+        // apart only by whether the book is now out.
+        ReplicationEvent::Kind kind = book.isCheckedOut ? ReplicationEvent::Kind::CHECKOUT : ReplicationEvent::Kind::RETURN;
+        if (id == KeyIndex::NONE)
+        {
+            id = m_books.insert(Book()).index;
+            m_isbn_index.add(book.isbn, id);
+            m_title_dictionary.set(id, book.title);
+            text_changed = true;
+            kind = ReplicationEvent::Kind::ADD;
+        }
+        else if (change.text_changed)
+        {
+            m_title_dictionary.set(id, book.title);
+            text_changed = true;
+            kind = ReplicationEvent::Kind::UPDATE;
+        }
+        if (m_replication_server.isRunning())
+            journalBookChange(kind, book);
+        storeBook(id, book);
+        if (book.isCheckedOut && book.dueDate != 0)
+            m_loans.track(id, book.dueDate);
+        else
+            m_loans.untrack(id);
+    }
+    // The records before these changes are gone from the segment, so the other
+    // indexes cannot be patched; they rebuild from it when next used.
+    if (text_changed)
+        m_catalog_generation++;
+    m_circulation_generation++;
+    applyBookChanges(touched);
+}
 
-// Constructor: Loads all data when the program starts.
-LibraryManager::LibraryManager(const std::string &books_path, const std::string &users_path)
+bool LibraryManager::publishToSharedCatalog(std::vector<SharedCatalog::Edit> &edits)
 {
-    m_books_filepath = books_path;
-    m_users_filepath = users_path;
-    loadBooks();
-    loadUsers();
+    TraceSpan span("publishToSharedCatalog");
+    std::vector<SharedCatalog::Change> earlier;
+    SharedCatalog::Result result = m_shared_catalog.apply(edits, earlier);
+    applySharedChanges(earlier);
+    switch (result)
+    {
+    case SharedCatalog::Result::OK:
+        m_books_unexported = true;
+        return true;
+    case SharedCatalog::Result::CONFLICT:
+        std::cout << Color::BOLD_RED << "The book was changed at another desk at the same time; your change was not applied."
+                  << Color::RESET << std::endl;
+        return false;
+    case SharedCatalog::Result::FULL:
+        std::cerr << Color::BOLD_RED << "ERROR: The shared catalog is full; your change was not applied." << Color::RESET << std::endl;
+        return false;
+    case SharedCatalog::Result::FAILED:
+        break;
+    }
+    std::cerr << Color::BOLD_RED << "ERROR: Could not write to the shared catalog; your change was not applied." << Color::RESET << std::endl;
+    return false;
 }
 
-// --- File I/O ---
+// --- Replication ---
+// The record layer journals every change as an ADD / UPDATE / CHECKOUT /
+// RETURN / REMOVE event keyed by ISBN and copy id, and the primary ships the
+// journal whenever it saves. Replicas apply the events to m_books in stream order.
 
-void LibraryManager::loadBooks()
+bool LibraryManager::enableReplicationPrimary(const std::string &socket_path)
 {
-    std::ifstream inputFile(m_books_filepath);
-    if (!inputFile.is_open())
+    if (!m_replication_server.start(socket_path, formatSnapshot()))
     {
-        std::cerr << Color::BOLD_RED << "ERROR: Could not open books data file: " << m_books_filepath << Color::RESET << std::endl;
-        return;
+        std::cerr << Color::BOLD_RED << "ERROR: Could not listen for replicas on " << socket_path << Color::RESET << std::endl;
+        return false;
     }
-    m_books.clear();
-    std::string line;
-    while (std::getline(inputFile, line))
-    {
-        if (line.empty())
-            continue;
-        if (line.back() == '\r')
-            line.pop_back();
-
-        std::stringstream ss(line);
-        std::string isbn, title, author, status_str, borrower;
-        std::getline(ss, isbn, ',');
-        std::getline(ss, title, ',');
-        std::getline(ss, author, ',');
-        std::getline(ss, status_str, ',');
-        std::getline(ss, borrower);
+    std::cout << Color::YELLOW << "Streaming catalog changes to replicas on " << socket_path << "." << Color::RESET << std::endl;
+    return true;
+}
 
-        Book newBook;
-        newBook.isbn = isbn;
-        newBook.title = title;
-        newBook.author = author;
-        newBook.isCheckedOut = (status_str == "1");
-        newBook.borrowerUsername = borrower;
-        m_books.push_back(newBook);
+bool LibraryManager::enableReplica(const std::string &socket_path)
+{
+    if (!m_replication_client.start(socket_path))
+    {
+        std::cerr << Color::BOLD_RED << "ERROR: Could not follow primary at " << socket_path << Color::RESET << std::endl;
+        return false;
+    }
+    // Give a running primary a moment to send its snapshot so the first menu is current.
+    for (int attempt = 0; attempt < 20 && m_replica.snapshots_loaded == 0; ++attempt)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        applyReplicationEvents();
+    }
+    if (m_replica.snapshots_loaded == 0)
+    {
+        std::cout << Color::YELLOW << "Primary at " << socket_path << " is not reachable yet; showing the local books file until it is."
+                  << Color::RESET << std::endl;
     }
+    return true;
 }
 
-void LibraryManager::saveBooks()
+void LibraryManager::journalBookChange(ReplicationEvent::Kind kind, const Book &book)
 {
-    std::ofstream outputFile(m_books_filepath);
-    if (!outputFile.is_open())
-    {
-        std::cerr << Color::BOLD_RED << "ERROR: Could not write to books data file: " << m_books_filepath << Color::RESET << std::endl;
+    ReplicationEvent event;
+    event.kind = kind;
+    event.copy_id = book.copyId;
+    if (kind == ReplicationEvent::Kind::REMOVE)
+        event.record = book.isbn;
+    else
+        BookCsv::appendRow(event.record, book, book.title);
+    m_journal.push_back(std::move(event));
+}
+
+void LibraryManager::shipJournal()
+{
+    if (m_journal.empty())
         return;
-    }
+    TraceSpan span("shipJournal");
+    m_replication_server.ship(std::move(m_journal));
+    m_journal.clear();
+    if (m_replication_server.wantsSnapshot())
+        m_replication_server.compact(formatSnapshot());
+}
+
+std::string LibraryManager::formatSnapshot() const
+{
+    std::string snapshot;
     for (const auto &book : m_books)
     {
-        outputFile << book.isbn << "," << book.title << "," << book.author
-                   << "," << (book.isCheckedOut ? "1" : "0") << "," << book.borrowerUsername << std::endl;
+        snapshot += std::to_string(book.copyId);
+        snapshot += ' ';
     }
+    snapshot += '\n';
+    snapshot += formatCatalog(); // Same slot order as the copy ids.
+    return snapshot;
 }
 
-void LibraryManager::loadUsers()
+void LibraryManager::applyReplicationEvents()
 {
-    std::ifstream inputFile(m_users_filepath);
-    if (!inputFile.is_open())
-    {
-        std::cerr << Color::BOLD_RED << "ERROR: Could not open users data file: " << m_users_filepath << Color::RESET << std::endl;
+    if (!isReplica())
         return;
-    }
-    m_users.clear();
-    std::string line;
-    while (std::getline(inputFile, line))
+    std::vector<ReplicationEvent> events;
+    m_replication_client.drain(events);
+    if (events.empty())
+        return;
+    TraceSpan span("applyReplicationEvents");
+    AllocScope alloc_scope(AllocStats::Subsystem::CATALOG);
+
+    int64_t now = nowMicros();
+    for (auto &event : events)
     {
-        if (line.empty())
+        m_replica.primary_seq = std::max(m_replica.primary_seq, event.seq);
+        if (event.kind == ReplicationEvent::Kind::HEARTBEAT)
+        {
+            m_replica.primary_seq = event.seq; // Authoritative, also after a primary restart.
+            m_replica.last_heartbeat_us = event.timestamp_us;
             continue;
-        if (line.back() == '\r')
-            line.pop_back();
-        std::stringstream ss(line);
-        std::string username, password, role_str;
-        std::getline(ss, username, ',');
-        std::getline(ss, password, ',');
-        std::getline(ss, role_str);
-        UserRole role = (role_str == "0" ? UserRole::LIBRARIAN : UserRole::MEMBER);
-        m_users.emplace_back(username, password, role);
+        }
+
+        if (event.kind == ReplicationEvent::Kind::SNAPSHOT)
+        {
+            // Sent on every (re)connect; replaces whatever we had.
+            size_t ids_end = std::min(event.record.find('\n'), event.record.size());
+            std::istringstream copy_ids(event.record.substr(0, ids_end));
+            std::vector<Book> books;
+            BookCsv::parse(event.record.substr(std::min(ids_end + 1, event.record.size())), books);
+            m_books.clear();
+            for (auto &book : books)
+            {
+                copy_ids >> book.copyId;
+                m_books.insert(std::move(book));
+            }
+            reindexBooks(false);
+            m_replica.primary_seq = event.seq;
+            m_replica.snapshots_loaded++;
+        }
+        else
+        {
+            std::vector<Book> parsed;
+            BookCsv::parse(event.record, parsed);
+            std::string isbn = (event.kind == ReplicationEvent::Kind::REMOVE) ? event.record
+                               : parsed.empty()                                ? std::string()
+                                                                               : parsed.front().isbn;
+            uint32_t existing = locateBook(isbn, event.copy_id);
+            if (event.kind == ReplicationEvent::Kind::REMOVE)
+            {
+                if (existing != KeyIndex::NONE)
+                    eraseBook(existing);
+            }
+            else if (!parsed.empty())
+            {
+                parsed.front().copyId = event.copy_id;
+                if (existing != KeyIndex::NONE)
+                    updateBook(existing, parsed.front());
+                else
+                    insertBook(parsed.front(), false);
+            }
+        }
+        m_replica.applied_seq = event.seq;
+        m_replica.events_applied++;
+        if (event.kind == ReplicationEvent::Kind::SNAPSHOT)
+            continue; // Its timestamp is when the snapshot was taken, not when it was sent.
+        m_replica.last_lag_us = event.received_us - event.timestamp_us;
+        m_replica.max_lag_us = std::max(m_replica.max_lag_us, m_replica.last_lag_us);
+        m_replica.last_apply_delay_us = now - event.received_us;
+        m_replica.max_apply_delay_us = std::max(m_replica.max_apply_delay_us, m_replica.last_apply_delay_us);
     }
 }
 
-void LibraryManager::saveUsers()
+void LibraryManager::displayReplicationStatus()
 {
-    std::ofstream outputFile(m_users_filepath);
-    if (!outputFile.is_open())
+    std::cout << Color::BOLD_CYAN << "\n--- Replication Status ---\n" << Color::RESET;
+    if (m_replication_server.isRunning())
+    {
+        std::cout << "Role: primary\n"
+                  << "Replicas connected: " << m_replication_server.replicaCount() << "\n"
+                  << "Last event shipped: #" << m_replication_server.lastSeq() << "\n";
+        return;
+    }
+    if (!isReplica())
     {
-        std::cerr << Color::BOLD_RED << "ERROR: Could not write to users data file: " << m_users_filepath << Color::RESET << std::endl;
+        std::cout << Color::YELLOW << "Replication is not enabled." << Color::RESET << std::endl;
         return;
     }
-    for (const auto &user : m_users)
+
+    applyReplicationEvents();
+    auto millis = [](int64_t micros)
+    { return std::to_string(micros / 1000) + " ms"; };
+    uint64_t behind = m_replica.primary_seq > m_replica.applied_seq ? m_replica.primary_seq - m_replica.applied_seq : 0;
+    std::cout << "Role: read-only replica\n"
+              << "Primary: " << (m_replication_client.isConnected() ? "connected" : Color::BOLD_RED + "disconnected" + Color::RESET) << "\n"
+              << "Applied through event: #" << m_replica.applied_seq << " (primary at #" << m_replica.primary_seq << ", "
+              << behind << " behind)\n"
+              << "Events applied: " << m_replica.events_applied << ", snapshots loaded: " << m_replica.snapshots_loaded << "\n";
+    if (m_replica.events_applied > m_replica.snapshots_loaded)
     {
-        int role_int = (user.getRole() == UserRole::LIBRARIAN) ? 0 : 1;
-        outputFile << user.getUsername() << "," << user.getPassword() << "," << role_int << std::endl;
+        std::cout << "Replication lag (created on primary -> received here): last " << millis(m_replica.last_lag_us)
+                  << ", worst " << millis(m_replica.max_lag_us) << "\n"
+                  << "Apply delay (received -> applied at the next menu): last " << millis(m_replica.last_apply_delay_us)
+                  << ", worst " << millis(m_replica.max_apply_delay_us) << "\n";
     }
+    if (m_replica.last_heartbeat_us != 0)
+        std::cout << "Last heartbeat from primary: " << millis(nowMicros() - m_replica.last_heartbeat_us) << " ago\n";
 }
 
 // --- User Management ---
 
-User *LibraryManager::validateUser(const std::string &username, const std::string &password)
+LibraryManager::UserHandle LibraryManager::validateUser(const std::string &username, const std::string &password)
 {
-    for (auto &user : m_users)
+    for (auto it = m_users.begin(); it != m_users.end(); ++it)
     {
-        if (user.getUsername() == username && user.checkPassword(password))
-            return &user;
+        if (it->getUsername() == username && it->checkPassword(password))
+            return m_users.handleAt(it.index());
     }
-    return nullptr;
+    return UserHandle();
+}
+
+const User *LibraryManager::findUser(UserHandle handle) const
+{
+    return m_users.get(handle);
 }
 
 // === FUNCTION UPDATED with username and password validation ===
@@ -211,7 +1417,8 @@ void LibraryManager::addUser()
         }
     }
     UserRole new_role = (role_choice == 0) ? UserRole::LIBRARIAN : UserRole::MEMBER;
-    m_users.emplace_back(new_username, new_password, new_role);
+    m_users.insert(User(new_username, new_password, new_role));
+    m_users_generation++;
     saveUsers();
     std::cout << "\n"
               << Color::BOLD_GREEN << "User '" << new_username << "' was added successfully!\n"
@@ -228,13 +1435,13 @@ void LibraryManager::removeUser()
         std::cout << Color::BOLD_RED << "Error: The default admin user cannot be removed." << Color::RESET << std::endl;
         return;
     }
-    auto original_size = m_users.size();
-    m_users.erase(
-        std::remove_if(m_users.begin(), m_users.end(), [&](const User &user)
-                       { return user.getUsername() == usernameToRemove; }),
-        m_users.end());
-    if (m_users.size() < original_size)
+    size_t removed = m_users.eraseIf([&](const User &user)
+                                     { return user.getUsername() == usernameToRemove; });
+    if (removed > 0)
     {
+        m_users_generation++;
+        m_holds.removeUser(usernameToRemove);
+        saveHolds();
         saveUsers();
         std::cout << Color::BOLD_GREEN << "User removed successfully." << Color::RESET << std::endl;
     }
@@ -251,9 +1458,18 @@ void LibraryManager::displayAllUsers()
         std::cout << "\nThere are no users in the system." << std::endl;
         return;
     }
-    std::sort(m_users.begin(), m_users.end(), [](const User &a, const User &b)
-              { return a.getUsername() < b.getUsername(); });
-    displayPaginatedUsers(m_users);
+    AllocScope alloc_scope(AllocStats::Subsystem::DISPLAY);
+    // Sort a permutation rather than m_users itself, so slot ids and handles stay put.
+    if (m_users_by_name_generation != m_users_generation)
+    {
+        m_users_by_name.clear();
+        for (auto it = m_users.begin(); it != m_users.end(); ++it)
+            m_users_by_name.push_back(it.index());
+        parallelStableSort(m_users_by_name, [this](uint32_t a, uint32_t b)
+                           { return m_users[a].getUsername() < m_users[b].getUsername(); });
+        m_users_by_name_generation = m_users_generation;
+    }
+    displayPaginatedUsers("All System Users (Sorted by Username)", m_users_by_name);
 }
 
 void LibraryManager::searchUserByUsername()
@@ -261,75 +1477,80 @@ void LibraryManager::searchUserByUsername()
     std::string searchTerm;
     std::cout << "\nEnter username to search for: ";
     std::cin >> searchTerm;
-    std::vector<User> foundUsers;
-    for (const auto &user : m_users)
-    {
-        if (user.getUsername().find(searchTerm) != std::string::npos)
-        {
-            foundUsers.push_back(user);
-        }
-    }
-    if (foundUsers.empty())
-    {
-        std::cout << "No users found matching that name." << std::endl;
-    }
-    else
+    SearchCache::Ids foundUsers;
     {
-        std::cout << "\n--- User Search Results ---\n";
-        tabulate::Table table;
-        table.add_row({"Username", "Role"});
-        for (const auto &user : foundUsers)
+        TraceSpan span("searchUserByUsername");
+        AllocScope alloc_scope(AllocStats::Subsystem::SEARCH);
+
+        // Usernames are matched case-sensitively, so the key is not lowercased.
+        const std::string cacheKey = "users:" + searchTerm;
+        foundUsers = m_search_cache.lookup(cacheKey, m_users_generation);
+        if (!foundUsers)
         {
-            table.add_row({user.getUsername(), (user.getRole() == UserRole::LIBRARIAN ? "Librarian" : "Member")});
+            std::vector<uint32_t> ids;
+            for (auto it = m_users.begin(); it != m_users.end(); ++it)
+            {
+                if (it->getUsername().find(searchTerm) != std::string::npos)
+                {
+                    ids.push_back(it.index());
+                }
+            }
+            AllocScope cache_scope(AllocStats::Subsystem::SEARCH_CACHE);
+            foundUsers = m_search_cache.store(cacheKey, m_users_generation, std::move(ids));
         }
-        std::cout << table << std::endl;
     }
+    displayPaginatedUsers("User Search Results (" + std::to_string(foundUsers->size()) + " found)", *foundUsers);
 }
 
-void LibraryManager::displayPaginatedUsers(const std::vector<User> &users)
+void LibraryManager::displayPaginatedUsers(const std::string &heading, const std::vector<uint32_t> &users)
 {
     const int page_size = 5;
     int current_page = 1;
     const int total_records = users.size();
-    const int total_pages = static_cast<int>(std::ceil(static_cast<double>(total_records) / page_size));
+    const int total_pages = std::max(1, static_cast<int>(std::ceil(static_cast<double>(total_records) / page_size)));
     char choice;
 
     do
     {
-        system("clear");
-        std::cout << "\n"
-                  << Color::BOLD_CYAN << "--- All System Users (Sorted by Username) ---" << Color::RESET << std::endl;
+        {
+            TraceSpan span("renderPageUsers");
+            system("clear");
+            std::cout << "\n"
+                      << Color::BOLD_CYAN << "--- " << heading << " ---" << Color::RESET << std::endl;
 
-        tabulate::Table table;
-        table.add_row({"Username", "Role"});
+            tabulate::Table table;
+            table.add_row({"Username", "Role"});
+            if (total_records == 0)
+                table.add_row({"No users to show.", ""});
 
-        int start_index = (current_page - 1) * page_size;
-        int end_index = std::min(start_index + page_size, total_records);
+            int start_index = (current_page - 1) * page_size;
+            int end_index = std::min(start_index + page_size, total_records);
 
-        for (int i = start_index; i < end_index; ++i)
-        {
-            const auto &user = users[i];
-            bool is_librarian = (user.getRole() == UserRole::LIBRARIAN);
-            std::string role_text = is_librarian ? "Librarian" : "Member";
+            for (int i = start_index; i < end_index; ++i)
+            {
+                const auto &user = m_users[users[i]];
+                bool is_librarian = (user.getRole() == UserRole::LIBRARIAN);
+                std::string role_text = is_librarian ? "Librarian" : "Member";
 
-            table.add_row({user.getUsername(), role_text});
+                table.add_row({user.getUsername(), role_text});
 
-            auto &row = table.row(table.size() - 1);
-            if (is_librarian)
-            {
-                row[1].format().font_color(tabulate::Color::magenta).font_style({tabulate::FontStyle::bold});
-            }
-            else
-            {
-                row[1].format().font_color(tabulate::Color::none);
+                auto &row = table.row(table.size() - 1);
+                if (is_librarian)
+                {
+                    row[1].format().font_color(tabulate::Color::magenta).font_style({tabulate::FontStyle::bold});
+                }
+                else
+                {
+                    row[1].format().font_color(tabulate::Color::none);
+                }
             }
-        }
 
-        table.format().border_top("=").border_bottom("=").border_left("|").border_right("|");
-        table.format().corner("o").corner_color(tabulate::Color::blue).border_color(tabulate::Color::blue);
-        table[0].format().font_style({tabulate::FontStyle::bold}).font_color(tabulate::Color::cyan).padding_top(1).padding_bottom(1);
+            table.format().border_top("=").border_bottom("=").border_left("|").border_right("|");
+            table.format().corner("o").corner_color(tabulate::Color::blue).border_color(tabulate::Color::blue);
+            table[0].format().font_style({tabulate::FontStyle::bold}).font_color(tabulate::Color::cyan).padding_top(1).padding_bottom(1);
 
-        std::cout << table << std::endl;
+            std::cout << table << std::endl;
+        }
 
         std::cout << Color::BOLD_WHITE << "Page " << current_page << " of " << total_pages << Color::RESET << std::endl;
         std::cout << Color::BOLD_YELLOW << "[N]" << Color::RESET << "ext Page | "
@@ -353,73 +1574,223 @@ void LibraryManager::displayPaginatedUsers(const std::vector<User> &users)
 
 void LibraryManager::displayAllBooks()
 {
-    if (m_books.empty())
+    if (m_books.empty() && m_branches.empty())
     {
         std::cout << "\nThe library has no books." << std::endl;
         return;
     }
-    std::sort(m_books.begin(), m_books.end(), [](const Book &a, const Book &b)
-              { return a.title < b.title; });
-    displayPaginatedBooks(m_books);
+
+    std::string input;
+    std::cout << "\nSort by (" << Color::BOLD_MAGENTA << "1" << Color::RESET << " title, "
+              << Color::BOLD_MAGENTA << "2" << Color::RESET << " author, "
+              << Color::BOLD_MAGENTA << "3" << Color::RESET << " availability, "
+              << Color::BOLD_MAGENTA << "4" << Color::RESET << " borrower) [1]: ";
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    std::getline(std::cin, input);
+
+    if (input == "2" || input == "3" || input == "4")
+    {
+        BookSortKey key = input == "2" ? BookSortKey::AUTHOR : input == "3" ? BookSortKey::AVAILABILITY : BookSortKey::BORROWER;
+        const char *heading = input == "2" ? "All Books in Library (Sorted by Author)"
+                              : input == "3" ? "All Books in Library (Available First)"
+                                             : "All Books in Library (Sorted by Borrower)";
+        const std::vector<uint32_t> &order = sortedBooks(key);
+        AllocScope alloc_scope(AllocStats::Subsystem::DISPLAY);
+        displayPaginatedBooks(
+            heading, order.size(),
+            [this, &order](size_t start, size_t end, std::vector<BookPageRow> &rows)
+            {
+                for (size_t i = start; i < end; ++i)
+                    rows.push_back({order[i], bookTitle(order[i])});
+            });
+        return;
+    }
+
+    if (!m_branches.empty())
+    {
+        displayAllBranchesByTitle();
+        return;
+    }
+
+    ensureTitleDictionary();
+    AllocScope alloc_scope(AllocStats::Subsystem::DISPLAY);
+    displayPaginatedBooks(
+        "All Books in Library (Sorted by Title)", m_title_dictionary.size(),
+        [this](size_t start, size_t end, std::vector<BookPageRow> &rows)
+        {
+            std::vector<std::string> titles;
+            m_title_dictionary.decodeRange(start, end, titles);
+            for (size_t i = 0; i < titles.size(); ++i)
+                rows.push_back({m_title_dictionary.idAt(start + i), std::move(titles[i])});
+        },
+        [this](const std::string &title)
+        { return m_title_dictionary.lowerBound(title); });
+}
+
+// m_books itself is never reordered, so slot ids held by the search indexes stay valid;
+// the dictionary's positions are the title order.
+void LibraryManager::ensureTitleDictionary()
+{
+    if (m_title_dictionary.compacted())
+        return;
+    TraceSpan span("compactTitleDictionary");
+    AllocScope alloc_scope(AllocStats::Subsystem::TITLE_DICTIONARY);
+    m_title_dictionary.compact();
+}
+
+// Book slot ids in `key` order, re-sorted only when the catalog (or, for the
+// orders that depend on loans, circulation) changed since the last call.
+// Ties fall back to title and then slot id, so the order is fully determined.
+const std::vector<uint32_t> &LibraryManager::sortedBooks(BookSortKey key)
+{
+    SortedView &view = m_book_views[static_cast<size_t>(key)];
+    if (view.catalog_generation == m_catalog_generation &&
+        (!sortUsesCirculation(key) || view.circulation_generation == m_circulation_generation))
+        return view.ids;
+
+    // Compacted, titles compare by dictionary position, and title order is the dictionary's own.
+    ensureTitleDictionary();
+    TraceSpan span("sortBooks");
+    AllocScope alloc_scope(AllocStats::Subsystem::DISPLAY);
+    view.ids.clear();
+    view.ids.reserve(m_books.size());
+    if (key == BookSortKey::TITLE)
+    {
+        for (size_t position = 0; position < m_title_dictionary.size(); ++position)
+            view.ids.push_back(m_title_dictionary.idAt(position));
+    }
+    else
+    {
+        for (auto it = m_books.begin(); it != m_books.end(); ++it)
+            view.ids.push_back(it.index());
+        if (recordsEvicted())
+        {
+            // The buffer pool serves one thread, so the records are read up front
+            // and the sort threads compare those copies.
+            std::vector<Book> fields(m_books.slotCount());
+            for (uint32_t id : view.ids)
+                bookFields(id, fields[id]);
+            parallelStableSort(view.ids, [this, key, &fields](uint32_t a, uint32_t b)
+                               { return booksInOrder(key, a, fields[a], b, fields[b]); });
+        }
+        else
+        {
+            parallelStableSort(view.ids, [this, key](uint32_t a, uint32_t b)
+                               { return booksInOrder(key, a, m_books[a], b, m_books[b]); });
+        }
+    }
+    view.catalog_generation = m_catalog_generation;
+    view.circulation_generation = m_circulation_generation;
+    return view.ids;
+}
+
+bool LibraryManager::booksInOrder(BookSortKey key, uint32_t a, const Book &x, uint32_t b, const Book &y) const
+{
+    auto byTitle = [&]()
+    { return m_title_dictionary.compare(a, b) < 0; };
+    switch (key)
+    {
+    case BookSortKey::AUTHOR:
+    {
+        int order = x.author.compare(y.author);
+        return order != 0 ? order < 0 : byTitle();
+    }
+    case BookSortKey::AVAILABILITY:
+        if (x.isCheckedOut != y.isCheckedOut)
+            return !x.isCheckedOut;
+        return byTitle();
+    case BookSortKey::BORROWER:
+    {
+        // Loans grouped by borrower, soonest due first; available books last.
+        if (x.isCheckedOut != y.isCheckedOut)
+            return x.isCheckedOut;
+        int order = x.borrowerUsername.compare(y.borrowerUsername);
+        if (order != 0)
+            return order < 0;
+        if (x.dueDate != y.dueDate)
+            return x.dueDate < y.dueDate;
+        return byTitle();
+    }
+    default:
+        return byTitle();
+    }
 }
 
-void LibraryManager::displayPaginatedBooks(const std::vector<Book> &books)
+void LibraryManager::displayPaginatedBooks(const std::string &heading, size_t record_count, const BookPageSource &fetchPage,
+                                           const std::function<size_t(const std::string &)> &findTitle)
 {
     const int page_size = 5;
     int current_page = 1;
-    const int total_records = books.size();
-    const int total_pages = static_cast<int>(std::ceil(static_cast<double>(total_records) / page_size));
+    const int total_records = static_cast<int>(record_count);
+    const int total_pages = std::max(1, static_cast<int>(std::ceil(static_cast<double>(total_records) / page_size)));
+    std::vector<BookPageRow> rows;
     char choice;
 
     do
     {
-        system("clear");
-        std::cout << "\n"
-                  << Color::BOLD_CYAN << "--- All Books in Library (Sorted by Title) ---" << Color::RESET << std::endl;
-
-        tabulate::Table table;
-        table.add_row({"ISBN", "Title", "Author", "Status"});
-
-        int start_index = (current_page - 1) * page_size;
-        int end_index = std::min(start_index + page_size, total_records);
-
-        for (int i = start_index; i < end_index; ++i)
         {
-            const auto &book = books[i];
-            std::string status_text;
+            TraceSpan span("renderPageBooks");
+            system("clear");
+            std::cout << "\n"
+                      << Color::BOLD_CYAN << "--- " << heading << " ---" << Color::RESET << std::endl;
 
-            if (book.isCheckedOut)
-            {
-                status_text = "Checked Out by: " + book.borrowerUsername;
-            }
+            tabulate::Table table;
+            const bool show_branch = !m_branches.empty();
+            if (show_branch)
+                table.add_row({"ISBN", "Title", "Author", "Status", "Branch"});
             else
+                table.add_row({"ISBN", "Title", "Author", "Status"});
+
+            int start_index = (current_page - 1) * page_size;
+            int end_index = std::min(start_index + page_size, total_records);
+            rows.clear();
+            if (start_index < end_index)
+                fetchPage(start_index, end_index, rows);
+            if (total_records == 0)
             {
-                status_text = "Available";
+                if (show_branch)
+                    table.add_row({"", "No books to show.", "", "", ""});
+                else
+                    table.add_row({"", "No books to show.", "", ""});
             }
 
-            table.add_row({book.isbn, book.title, book.author, status_text});
-
-            auto &row = table.row(table.size() - 1);
-            if (!book.isCheckedOut)
-            {
-                row[3].format().font_color(tabulate::Color::green).font_style({tabulate::FontStyle::bold});
-            }
-            else
+            for (const auto &page_row : rows)
             {
-                row.format().font_color(tabulate::Color::red);
+                const auto &book = pageRowBook(page_row);
+                if (show_branch)
+                {
+                    const std::string &branch = page_row.branch == HOME_BRANCH ? std::string("(this branch)") : m_branches[page_row.branch]->name();
+                    table.add_row({book.isbn, page_row.title, book.author, statusText(book), branch});
+                }
+                else
+                {
+                    table.add_row({book.isbn, page_row.title, book.author, statusText(book)});
+                }
+
+                auto &row = table.row(table.size() - 1);
+                if (!book.isCheckedOut)
+                {
+                    row[3].format().font_color(tabulate::Color::green).font_style({tabulate::FontStyle::bold});
+                }
+                else
+                {
+                    row.format().font_color(tabulate::Color::red);
+                }
             }
-        }
 
-        table.format().border_top("=").border_bottom("=").border_left("|").border_right("|");
-        table.format().corner("o").corner_color(tabulate::Color::blue).border_color(tabulate::Color::blue);
-        table[0].format().font_style({tabulate::FontStyle::bold}).font_color(tabulate::Color::cyan).padding_top(1).padding_bottom(1);
+            table.format().border_top("=").border_bottom("=").border_left("|").border_right("|");
+            table.format().corner("o").corner_color(tabulate::Color::blue).border_color(tabulate::Color::blue);
+            table[0].format().font_style({tabulate::FontStyle::bold}).font_color(tabulate::Color::cyan).padding_top(1).padding_bottom(1);
 
-        std::cout << table << std::endl;
+            std::cout << table << std::endl;
+        }
 
         std::cout << Color::BOLD_WHITE << "Page " << current_page << " of " << total_pages << Color::RESET << std::endl;
         std::cout << Color::BOLD_YELLOW << "[N]" << Color::RESET << "ext Page | "
-                  << Color::BOLD_YELLOW << "[P]" << Color::RESET << "revious Page | "
-                  << Color::BOLD_YELLOW << "[Q]" << Color::RESET << "uit to Menu" << std::endl;
+                  << Color::BOLD_YELLOW << "[P]" << Color::RESET << "revious Page | ";
+        if (findTitle)
+            std::cout << Color::BOLD_YELLOW << "[J]" << Color::RESET << "ump to Title | ";
+        std::cout << Color::BOLD_YELLOW << "[Q]" << Color::RESET << "uit to Menu" << std::endl;
         std::cout << "Enter your choice: ";
 
         std::cin >> choice;
@@ -430,101 +1801,366 @@ void LibraryManager::displayPaginatedBooks(const std::vector<Book> &books)
             current_page++;
         if (choice == 'p' && current_page > 1)
             current_page--;
+        if (choice == 'j' && findTitle)
+        {
+            std::string title;
+            std::cout << "Jump to title starting with: ";
+            std::getline(std::cin, title);
+            int position = static_cast<int>(findTitle(title));
+            current_page = std::max(1, std::min(total_pages, position / page_size + 1));
+        }
 
     } while (choice != 'q');
 }
 
+// Asks for username and password until they match or the user gives up.
+// Returns nullptr if the user chose to exit.
+User *LibraryManager::verifyIdentity(const std::string &purpose, const std::string &cancelled_message)
+{
+    while (true)
+    { // Loop for authentication
+        std::string username, password;
+        std::cout << "\n"
+                  << Color::BOLD_WHITE << "--- Please Verify Your Identity to " << purpose << " ---\n"
+                  << Color::RESET;
+        std::cout << Color::YELLOW << "Enter your username: " << Color::RESET;
+        std::cin >> username;
+        std::cout << Color::YELLOW << "Enter your password: " << Color::RESET;
+        std::cin >> password;
+
+        User *user = m_users.get(validateUser(username, password));
+        if (user != nullptr)
+            return user;
+
+        std::cout << "\n"
+                  << Color::BOLD_RED << "Authentication failed. Invalid username or password." << Color::RESET << std::endl;
+        char choice;
+        std::cout << "Would you like to (R)etry or (E)xit? ";
+        std::cin >> choice;
+        if (std::tolower(choice) == 'e')
+        {
+            std::cout << cancelled_message << std::endl;
+            return nullptr;
+        }
+        // If they choose 'r' or anything else, the loop will just continue
+    }
+}
+
 void LibraryManager::checkOutBook()
 {
     std::string isbn;
     std::cout << "\nEnter ISBN of the book to borrow: ";
     std::cin >> isbn;
 
-    Book *book = findBookByISBN(isbn);
+    uint32_t id = findBookByISBN(isbn);
+    if (id == KeyIndex::NONE)
+    {
+        std::cout << Color::BOLD_RED << "Error: Book not found." << Color::RESET << std::endl;
+        return;
+    }
+
+    // Any free copy will do; if there is none, the first copy's borrower is named.
+    size_t free_copies = 0;
+    uint32_t free_copy = findCopy(isbn, false, {}, free_copies);
+    if (free_copy != KeyIndex::NONE)
+        id = free_copy;
+    Book book = bookAt(id);
+    if (book.isCheckedOut)
+    {
+        std::cout << Color::YELLOW << "Sorry, this book is already checked out by user '" << book.borrowerUsername << "'." << Color::RESET << std::endl;
+        char choice;
+        std::cout << "Would you like to place a hold and get it when it is returned? (y/n) ";
+        std::cin >> choice;
+        if (std::tolower(choice) == 'y')
+            placeHold(id);
+        return;
+    }
+
+    User *user = verifyIdentity("Borrow", "Checkout cancelled.");
+    if (user == nullptr)
+        return;
+
+    // This part now only runs after a successful login
+    const Book read = book;
+    book.isCheckedOut = true;
+    book.borrowerUsername = user->getUsername();
+    book.dueDate = std::time(nullptr) + LOAN_PERIOD_SECONDS;
+    if (!updateBook(id, book, &read))
+        return;
+    saveBooks();
+    std::cout << "\n"
+              << Color::BOLD_GREEN << "Successfully borrowed '" << book.title << "'! It is due back on "
+              << formatDate(book.dueDate) << "." << Color::RESET << std::endl;
+}
+
+void LibraryManager::placeHold(uint32_t id)
+{
+    Book buffer;
+    const Book &book = bookFields(id, buffer);
+    User *user = verifyIdentity("Place a Hold", "Hold cancelled.");
+    if (user == nullptr)
+        return;
+    if (user->getUsername() == book.borrowerUsername)
+    {
+        std::cout << Color::YELLOW << "You already have this book." << Color::RESET << std::endl;
+        return;
+    }
+
+    size_t position = m_holds.place(book.isbn, user->getUsername());
+    if (position == 0)
+    {
+        std::cout << Color::YELLOW << "You already have a hold on '" << bookTitle(id) << "'." << Color::RESET << std::endl;
+        return;
+    }
+    saveHolds();
+    std::cout << "\n"
+              << Color::BOLD_GREEN << "Hold placed on '" << bookTitle(id) << "'. You are number " << position
+              << " in line." << Color::RESET << std::endl;
+}
+
+void LibraryManager::cancelHold()
+{
+    std::string isbn;
+    std::cout << "\nEnter ISBN of the book to cancel your hold on: ";
+    std::cin >> isbn;
+
+    User *user = verifyIdentity("Cancel a Hold", "Nothing was cancelled.");
+    if (user == nullptr)
+        return;
+
+    if (m_holds.cancel(isbn, user->getUsername()))
+    {
+        saveHolds();
+        std::cout << Color::BOLD_GREEN << "Your hold was cancelled." << Color::RESET << std::endl;
+    }
+    else
+    {
+        std::cout << Color::BOLD_RED << "Error: You have no hold on that book." << Color::RESET << std::endl;
+    }
+}
+
+void LibraryManager::returnBook()
+{
+    std::string isbn;
+    std::cout << "\nEnter ISBN of the book to return: ";
+    std::cin >> isbn;
 
-    if (book == nullptr)
+    uint32_t id = findBookByISBN(isbn);
+    if (id == KeyIndex::NONE)
     {
         std::cout << Color::BOLD_RED << "Error: Book not found." << Color::RESET << std::endl;
         return;
     }
 
-    if (book->isCheckedOut)
+    size_t lent_copies = 0;
+    uint32_t lent_copy = findCopy(isbn, true, {}, lent_copies);
+    if (lent_copy != KeyIndex::NONE)
+        id = lent_copy;
+    Book book = bookAt(id);
+    if (!book.isCheckedOut)
+    {
+        std::cout << Color::YELLOW << "This book is already in the library and was not checked out." << Color::RESET << std::endl;
+        return;
+    }
+
+    const Book read = book;
+    std::string borrower = book.borrowerUsername;
+    book.isCheckedOut = false;
+    book.borrowerUsername = "";
+    book.dueDate = 0;
+
+    // Hand the book straight to the next person waiting for it; the hold is
+    // only used up if the return goes through.
+    HoldQueue holds_before = m_holds;
+    std::string next_holder;
+    if (m_holds.popNext(book.isbn, next_holder))
+    {
+        book.isCheckedOut = true;
+        book.borrowerUsername = next_holder;
+        book.dueDate = std::time(nullptr) + LOAN_PERIOD_SECONDS;
+    }
+    if (!updateBook(id, book, &read))
+    {
+        m_holds = std::move(holds_before);
+        return;
+    }
+    if (!next_holder.empty())
+        saveHolds();
+    saveBooks();
+
+    std::cout << "\n"
+              << Color::BOLD_GREEN << "Successfully returned '" << book.title << "' (was borrowed by " << borrower << ")." << Color::RESET << std::endl;
+    if (!next_holder.empty())
+    {
+        std::cout << Color::BOLD_CYAN << "It is now checked out to '" << next_holder << "', who had it on hold." << Color::RESET << std::endl;
+    }
+}
+
+// --- Basket Checkout / Return ---
+// Every ISBN is checked before anything changes, so a basket is applied
+// entirely or not at all, and the catalog is saved once per basket. Each line
+// takes a copy of its own, so an ISBN may be listed once per copy.
+
+void LibraryManager::checkOutBasket()
+{
+    std::cout << "\nEnter the ISBNs of the books to borrow (separated by spaces): ";
+    std::vector<std::string> isbns = readIsbnList();
+    if (isbns.empty())
     {
-        std::cout << Color::YELLOW << "Sorry, this book is already checked out by user '" << book->borrowerUsername << "'." << Color::RESET << std::endl;
+        std::cout << Color::BOLD_RED << "Error: No ISBNs entered." << Color::RESET << std::endl;
         return;
     }
 
-    User *user = nullptr;
-    while (true)
-    { // Loop for authentication
-        std::string username, password;
-        std::cout << "\n"
-                  << Color::BOLD_WHITE << "--- Please Verify Your Identity to Borrow ---\n"
-                  << Color::RESET;
-        std::cout << Color::YELLOW << "Enter your username: " << Color::RESET;
-        std::cin >> username;
-        std::cout << Color::YELLOW << "Enter your password: " << Color::RESET;
-        std::cin >> password;
-
-        user = validateUser(username, password);
-
-        if (user != nullptr)
+    std::vector<Book> basket;
+    std::vector<uint32_t> basket_ids;
+    std::vector<std::string> problems;
+    std::vector<std::string> reported;
+    for (const auto &isbn : isbns)
+    {
+        uint32_t first = findBookByISBN(isbn);
+        size_t free_copies = 0;
+        uint32_t id = findCopy(isbn, false, basket_ids, free_copies);
+        if (id != KeyIndex::NONE)
         {
-            // Success! Break the loop.
-            break;
+            basket.push_back(bookAt(id));
+            basket_ids.push_back(id);
         }
+        else if (std::find(reported.begin(), reported.end(), isbn) != reported.end())
+            continue; // One problem per ISBN, however often it is listed.
+        else if (first == KeyIndex::NONE)
+            problems.push_back(isbn + ": not found");
+        else if (free_copies == 0 && m_isbn_index.findAll(isbn).size() == 1)
+            problems.push_back(isbn + ": already checked out by '" + bookAt(first).borrowerUsername + "'");
+        else if (free_copies == 0)
+            problems.push_back(isbn + ": every copy is checked out");
         else
         {
-            // Failure
-            std::cout << "\n"
-                      << Color::BOLD_RED << "Authentication failed. Invalid username or password." << Color::RESET << std::endl;
-            char choice;
-            std::cout << "Would you like to (R)etry or (E)xit? ";
-            std::cin >> choice;
-            if (std::tolower(choice) == 'e')
-            {
-                std::cout << "Checkout cancelled." << std::endl;
-                return; // Exit the function entirely
-            }
-            // If they choose 'r' or anything else, the loop will just continue
+            size_t listed = std::count(isbns.begin(), isbns.end(), isbn);
+            problems.push_back(isbn + ": listed " + std::to_string(listed) + " times but only " + std::to_string(free_copies) +
+                               " cop" + (free_copies == 1 ? "y is" : "ies are") + " free");
         }
+        if (id == KeyIndex::NONE)
+            reported.push_back(isbn);
+    }
+    if (!problems.empty())
+    {
+        std::cout << Color::BOLD_RED << "Nothing was checked out:" << Color::RESET << std::endl;
+        for (const auto &problem : problems)
+            std::cout << "  - " << problem << std::endl;
+        return;
     }
 
-    // This part now only runs after a successful login
-    book->isCheckedOut = true;
-    book->borrowerUsername = user->getUsername();
+    User *user = verifyIdentity("Borrow " + std::to_string(basket.size()) + " Book(s)", "Checkout cancelled.");
+    if (user == nullptr)
+        return;
+
+    TraceSpan span("checkOutBasket");
+    std::time_t due = std::time(nullptr) + LOAN_PERIOD_SECONDS;
+    const std::vector<Book> read = basket;
+    for (auto &book : basket)
+    {
+        book.isCheckedOut = true;
+        book.borrowerUsername = user->getUsername();
+        book.dueDate = due;
+    }
+    if (!updateBooks(basket_ids, basket, read))
+        return;
     saveBooks();
+
     std::cout << "\n"
-              << Color::BOLD_GREEN << "Successfully borrowed '" << book->title << "'!" << Color::RESET << std::endl;
+              << Color::BOLD_GREEN << "Successfully borrowed " << basket.size() << " book(s), due back on "
+              << formatDate(due) << ":" << Color::RESET << std::endl;
+    for (const auto &book : basket)
+        std::cout << "  - " << book.title << std::endl;
 }
 
-void LibraryManager::returnBook()
+void LibraryManager::returnBasket()
 {
-    std::string isbn;
-    std::cout << "\nEnter ISBN of the book to return: ";
-    std::cin >> isbn;
-
-    Book *book = findBookByISBN(isbn);
-
-    if (book == nullptr)
+    std::cout << "\nEnter the ISBNs of the books to return (separated by spaces): ";
+    std::vector<std::string> isbns = readIsbnList();
+    if (isbns.empty())
     {
-        std::cout << Color::BOLD_RED << "Error: Book not found." << Color::RESET << std::endl;
+        std::cout << Color::BOLD_RED << "Error: No ISBNs entered." << Color::RESET << std::endl;
         return;
     }
 
-    if (!book->isCheckedOut)
+    std::vector<Book> basket;
+    std::vector<uint32_t> basket_ids;
+    std::vector<std::string> problems;
+    std::vector<std::string> reported;
+    for (const auto &isbn : isbns)
     {
-        std::cout << Color::YELLOW << "This book is already in the library and was not checked out." << Color::RESET << std::endl;
+        size_t lent_copies = 0;
+        uint32_t id = findCopy(isbn, true, basket_ids, lent_copies);
+        if (id != KeyIndex::NONE)
+        {
+            basket.push_back(bookAt(id));
+            basket_ids.push_back(id);
+        }
+        else if (std::find(reported.begin(), reported.end(), isbn) != reported.end())
+            continue; // One problem per ISBN, however often it is listed.
+        else if (findBookByISBN(isbn) == KeyIndex::NONE)
+            problems.push_back(isbn + ": not found");
+        else if (lent_copies == 0)
+            problems.push_back(isbn + ": was not checked out");
+        else
+        {
+            size_t listed = std::count(isbns.begin(), isbns.end(), isbn);
+            problems.push_back(isbn + ": listed " + std::to_string(listed) + " times but only " + std::to_string(lent_copies) +
+                               " cop" + (lent_copies == 1 ? "y is" : "ies are") + " checked out");
+        }
+        if (id == KeyIndex::NONE)
+            reported.push_back(isbn);
+    }
+    if (!problems.empty())
+    {
+        std::cout << Color::BOLD_RED << "Nothing was returned:" << Color::RESET << std::endl;
+        for (const auto &problem : problems)
+            std::cout << "  - " << problem << std::endl;
         return;
     }
 
-    std::string borrower = book->borrowerUsername;
-    book->isCheckedOut = false;
-    book->borrowerUsername = "";
+    TraceSpan span("returnBasket");
+    std::time_t due = std::time(nullptr) + LOAN_PERIOD_SECONDS;
+    const std::vector<Book> read = basket;
+    // Holds are only used up if the whole basket goes through.
+    HoldQueue holds_before = m_holds;
+    std::vector<std::string> next_holders(basket.size());
+    for (size_t i = 0; i < basket.size(); ++i)
+    {
+        Book &book = basket[i];
+        book.isCheckedOut = false;
+        book.borrowerUsername = "";
+        book.dueDate = 0;
+        if (m_holds.popNext(book.isbn, next_holders[i]))
+        {
+            book.isCheckedOut = true;
+            book.borrowerUsername = next_holders[i];
+            book.dueDate = due;
+        }
+    }
+    if (!updateBooks(basket_ids, basket, read))
+    {
+        m_holds = std::move(holds_before);
+        return;
+    }
+    if (std::any_of(next_holders.begin(), next_holders.end(), [](const std::string &holder)
+                    { return !holder.empty(); }))
+        saveHolds();
     saveBooks();
 
     std::cout << "\n"
-              << Color::BOLD_GREEN << "Successfully returned '" << book->title << "' (was borrowed by " << borrower << ")." << Color::RESET << std::endl;
+              << Color::BOLD_GREEN << "Successfully returned " << basket.size() << " book(s):" << Color::RESET << std::endl;
+    for (size_t i = 0; i < basket.size(); ++i)
+    {
+        std::cout << "  - " << read[i].title << " (was borrowed by " << read[i].borrowerUsername << ")";
+        if (!next_holders[i].empty())
+        {
+            std::cout << Color::BOLD_CYAN << " -> now checked out to '" << next_holders[i] << "', who had it on hold"
+                      << Color::RESET;
+        }
+        std::cout << std::endl;
+    }
 }
 
 void LibraryManager::addBook()
@@ -565,7 +2201,7 @@ void LibraryManager::addBook()
             continue;
         }
 
-        if (findBookByISBN(isbn_input) != nullptr)
+        if (findBookByISBN(isbn_input) != KeyIndex::NONE)
         {
             std::cout << Color::BOLD_RED << "\nError: A book with ISBN '" << isbn_input << "' already exists." << Color::RESET << std::endl;
             return;
@@ -582,16 +2218,34 @@ void LibraryManager::addBook()
     std::cout << "  Author: ";
     std::getline(std::cin, newBook.author);
 
-    for (const auto &book : m_books)
+    // Only the author's books are read; the facet matches names case-insensitively.
+    ensureFacetIndex();
+    std::vector<uint32_t> same_author;
+    if (const RoaringBitmap *facet = m_facets.author(newBook.author))
+        facet->appendTo(same_author);
+    Book buffer;
+    for (uint32_t id : same_author)
     {
-        if (book.title == newBook.title && book.author == newBook.author)
+        if (bookFields(id, buffer).author == newBook.author && bookTitle(id) == newBook.title)
         {
             std::cout << Color::BOLD_RED << "\nError: A book with the same title and author already exists." << Color::RESET << std::endl;
             return;
         }
     }
 
-    m_books.push_back(newBook);
+    if (m_page_store.isOpen() && !BookPageStore::fits(newBook))
+    {
+        std::cout << Color::BOLD_RED << "\nError: Title or author is too long for the page store." << Color::RESET << std::endl;
+        return;
+    }
+    if (m_shared_catalog.isOpen() && !SharedCatalog::fits(newBook))
+    {
+        std::cout << Color::BOLD_RED << "\nError: Title or author is too long for the shared catalog." << Color::RESET << std::endl;
+        return;
+    }
+
+    if (insertBook(newBook) == KeyIndex::NONE)
+        return;
     saveBooks();
     std::cout << "\n"
               << Color::BOLD_GREEN << "Book added successfully!\n"
@@ -603,13 +2257,29 @@ void LibraryManager::removeBook()
     std::string isbn;
     std::cout << "\nEnter ISBN of the book to remove: ";
     std::cin >> isbn;
-    auto original_size = m_books.size();
-    m_books.erase(
-        std::remove_if(m_books.begin(), m_books.end(), [&](const Book &book)
-                       { return book.isbn == isbn; }),
-        m_books.end());
-    if (m_books.size() < original_size)
+    std::vector<uint32_t> removed = m_isbn_index.findAll(isbn); // Every copy of the ISBN.
+    size_t erased = 0;
+    for (uint32_t id : removed)
+    {
+        if (!eraseBook(id))
+            break;
+        erased++;
+    }
+    if (erased < removed.size())
+    {
+        // With a shared catalog another desk changed a copy first; the ones before it are gone.
+        if (erased > 0)
+            saveBooks();
+        std::cout << Color::BOLD_RED << "Error: " << removed.size() - erased << " of " << removed.size()
+                  << " copies were not removed." << Color::RESET << std::endl;
+    }
+    else if (!removed.empty())
     {
+        if (m_holds.waitingFor(isbn) > 0)
+        {
+            m_holds.removeBook(isbn);
+            saveHolds();
+        }
         saveBooks();
         std::cout << "Book removed successfully." << std::endl;
     }
@@ -619,48 +2289,675 @@ void LibraryManager::removeBook()
     }
 }
 
+// Ranked search over title and author. Falls back to a plain substring match on the
+// title when no whole word matches (e.g. a partial word such as "procra").
 void LibraryManager::searchBookByTitle()
 {
     std::string searchTerm;
-    std::cout << "\nEnter title to search for: ";
+    std::cout << "\nEnter title or author to search for: ";
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
     std::getline(std::cin, searchTerm);
-    std::transform(searchTerm.begin(), searchTerm.end(), searchTerm.begin(), ::tolower);
-    std::vector<Book> foundBooks;
-    for (const auto &book : m_books)
+    if (!m_branches.empty())
+    {
+        searchAllBranches(searchTerm);
+        return;
+    }
+    SearchCache::Ids foundBooks;
     {
-        std::string bookTitle = book.title;
-        std::transform(bookTitle.begin(), bookTitle.end(), bookTitle.begin(), ::tolower);
-        if (bookTitle.find(searchTerm) != std::string::npos)
+        // Ends before paging starts, so the span does not include the reader's time.
+        TraceSpan span("searchBookByTitle");
+        AllocScope alloc_scope(AllocStats::Subsystem::SEARCH);
+
+        // The cache key and the search itself use the same normalized term.
+        const std::string term = SearchCache::normalize(searchTerm);
+        const std::string cacheKey = "books:" + term;
+        foundBooks = m_search_cache.lookup(cacheKey, m_catalog_generation);
+        if (!foundBooks)
         {
-            foundBooks.push_back(book);
+            // One hit more than is shown tells whether the list was cut short.
+            std::vector<uint32_t> ids;
+            for (const auto &hit : rankBooks(term, SEARCH_LIMIT + 1))
+                ids.push_back(hit.doc);
+            AllocScope cache_scope(AllocStats::Subsystem::SEARCH_CACHE);
+            foundBooks = m_search_cache.store(cacheKey, m_catalog_generation, std::move(ids));
         }
     }
-    if (foundBooks.empty())
+
+    // Rows are read from m_books one page at a time; only the id list is held.
+    const std::vector<uint32_t> &results = *foundBooks;
+    size_t shown = results.size() > SEARCH_LIMIT ? SEARCH_LIMIT : results.size();
+    displayPaginatedBooks(
+        "Search Results " + resultCount(results.size(), SEARCH_LIMIT), shown,
+        [this, &results](size_t start, size_t end, std::vector<BookPageRow> &rows)
+        {
+            for (size_t i = start; i < end; ++i)
+                rows.push_back({results[i], bookTitle(results[i])});
+        });
+}
+
+// Only reads m_books and the text index once it is built, so it can run
+// alongside the branch searches.
+std::vector<Bm25Index::Hit> LibraryManager::rankBooks(const std::string &term, size_t limit)
+{
+    ensureTextIndex();
+    std::vector<Bm25Index::Hit> hits = m_text_index.search(term, limit);
+    if (hits.empty())
     {
-        std::cout << "No books found matching your search." << std::endl;
+        auto sameLetter = [](char a, char b)
+        { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); };
+        std::string bookTitle;
+        for (auto it = m_books.begin(); it != m_books.end() && hits.size() < limit; ++it)
+        {
+            m_title_dictionary.title(it.index(), bookTitle);
+            if (std::search(bookTitle.begin(), bookTitle.end(), term.begin(), term.end(), sameLetter) != bookTitle.end())
+                hits.push_back({it.index(), 0.0});
+        }
     }
-    else
+    return hits;
+}
+
+void LibraryManager::setSearchCacheBudget(size_t bytes)
+{
+    m_search_cache.setBudget(bytes);
+}
+
+void LibraryManager::displaySearchCacheStats()
+{
+    SearchCache::Stats stats = m_search_cache.stats();
+    uint64_t lookups = stats.hits + stats.misses;
+    double hit_rate = lookups == 0 ? 0.0 : 100.0 * static_cast<double>(stats.hits) / static_cast<double>(lookups);
+
+    std::cout << "\n"
+              << Color::BOLD_CYAN << "--- Search Cache Statistics ---" << Color::RESET << std::endl;
+    tabulate::Table table;
+    table.add_row({"Metric", "Value"});
+    table.add_row({"Hits", std::to_string(stats.hits)});
+    table.add_row({"Misses", std::to_string(stats.misses)});
+    table.add_row({"  of which stale", std::to_string(stats.stale)});
+    table.add_row({"Hit rate", std::to_string(static_cast<int>(hit_rate + 0.5)) + "%"});
+    table.add_row({"Evictions", std::to_string(stats.evictions)});
+    table.add_row({"Cached queries", std::to_string(stats.entries)});
+    table.add_row({"Memory used / budget", std::to_string(stats.bytes / 1024) + " KiB / " + std::to_string(stats.budget_bytes / 1024) + " KiB"});
+    table[0].format().font_style({tabulate::FontStyle::bold}).font_color(tabulate::Color::cyan);
+    std::cout << table << std::endl;
+}
+
+// Heap use per subsystem (needs LIBRARY_ENABLE_ALLOC_STATS) plus what the main
+// structures report about themselves.
+void LibraryManager::displayMemoryReport()
+{
+    std::cout << "\n"
+              << Color::BOLD_CYAN << "--- Memory Report ---" << Color::RESET << std::endl;
+
+    if (AllocStats::enabled())
     {
-        std::cout << "\n--- Search Results ---\n";
         tabulate::Table table;
-        table.add_row({"ISBN", "Title", "Author", "Status"});
-        for (const auto &book : foundBooks)
+        table.add_row({"Subsystem", "Live", "Peak", "Allocations", "Frees"});
+        for (size_t i = 0; i < static_cast<size_t>(AllocStats::Subsystem::COUNT); ++i)
         {
-            table.add_row({book.isbn, book.title, book.author, (book.isCheckedOut ? "Checked Out by: " + book.borrowerUsername : "Available")});
+            auto subsystem = static_cast<AllocStats::Subsystem>(i);
+            AllocStats::Counters counters = AllocStats::counters(subsystem);
+            table.add_row({AllocStats::name(subsystem), formatBytes(counters.live_bytes), formatBytes(counters.peak_live_bytes),
+                           std::to_string(counters.allocations), std::to_string(counters.frees)});
         }
+        table[0].format().font_style({tabulate::FontStyle::bold}).font_color(tabulate::Color::cyan);
         std::cout << table << std::endl;
+        if (!m_books.empty())
+        {
+            std::cout << "Last catalog load: " << m_books_load_allocations << " allocations for " << m_books.size()
+                      << " books (" << (m_books_load_allocations / m_books.size()) << " per book)." << std::endl;
+        }
+    }
+    else
+    {
+        std::cout << Color::YELLOW << "Allocation counting is off. Rebuild with -DLIBRARY_ENABLE_ALLOC_STATS=ON to see heap use per subsystem."
+                  << Color::RESET << std::endl;
+    }
+
+    SearchCache::Stats cache = m_search_cache.stats();
+    tabulate::Table structures;
+    structures.add_row({"Structure", "Entries", "Size"});
+    structures.add_row({"Books (slot map)", std::to_string(m_books.size()), formatBytes(static_cast<int64_t>(m_books.memoryBytes()))});
+    if (m_page_store.isOpen())
+        structures.add_row({"Page store buffer pool (records on disk)", std::to_string(m_page_store.size()), formatBytes(static_cast<int64_t>(m_page_store.poolBytes()))});
+    structures.add_row({"Users (slot map)", std::to_string(m_users.size()), formatBytes(static_cast<int64_t>(m_users.memoryBytes()))});
+    structures.add_row({"Title dictionary (raw titles)", std::to_string(m_title_dictionary.size()), formatBytes(static_cast<int64_t>(m_title_dictionary.rawBytes()))});
+    structures.add_row({"Title dictionary (front-coded)", std::to_string(m_title_dictionary.size()), formatBytes(static_cast<int64_t>(m_title_dictionary.encodedBytes()))});
+    structures.add_row({"Facet bitmaps (authors / borrowers)", std::to_string(m_facets.authorCount()) + " / " + std::to_string(m_facets.borrowerCount()),
+                        formatBytes(static_cast<int64_t>(m_facets.memoryBytes()))});
+    structures.add_row({"Search cache", std::to_string(cache.entries), formatBytes(static_cast<int64_t>(cache.bytes))});
+    size_t branch_books = 0;
+    for (const auto &branch : m_branches)
+        branch_books += branch->books().size();
+    structures.add_row({"Mounted branches (books)", std::to_string(m_branches.size()) + " (" + std::to_string(branch_books) + ")", "-"});
+    structures.add_row({"Holds", std::to_string(m_holds.size()), "-"});
+    structures.add_row({"Loans with due dates", std::to_string(m_loans.size()), "-"});
+    structures[0].format().font_style({tabulate::FontStyle::bold}).font_color(tabulate::Color::cyan);
+    std::cout << structures << std::endl;
+}
+
+void LibraryManager::exportCatalog()
+{
+    CatalogExporter::Options options;
+    std::string input;
+    std::cout << "\n"
+              << Color::BOLD_CYAN << "--- Export Catalog ---\n"
+              << Color::RESET;
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+    std::cout << "  Format (" << Color::BOLD_MAGENTA << "1" << Color::RESET << " CSV, "
+              << Color::BOLD_MAGENTA << "2" << Color::RESET << " JSON Lines) [1]: ";
+    std::getline(std::cin, input);
+    options.format = (input == "2") ? CatalogExporter::Format::JSON_LINES : CatalogExporter::Format::CSV;
+
+    std::cout << "  Books (" << Color::BOLD_MAGENTA << "0" << Color::RESET << " all, "
+              << Color::BOLD_MAGENTA << "1" << Color::RESET << " available, "
+              << Color::BOLD_MAGENTA << "2" << Color::RESET << " checked out) [0]: ";
+    std::getline(std::cin, input);
+    if (input == "1")
+        options.status = CatalogExporter::StatusFilter::AVAILABLE;
+    else if (input == "2")
+        options.status = CatalogExporter::StatusFilter::CHECKED_OUT;
+
+    std::cout << "  Only borrowed by username (blank for any): ";
+    std::getline(std::cin, options.borrower);
+    std::cout << "  Only authors containing (blank for any): ";
+    std::getline(std::cin, options.author);
+
+    std::cout << "  Columns, comma separated (isbn,title,author,status,borrower,due; blank for all): ";
+    std::getline(std::cin, input);
+    if (!input.empty() && !CatalogExporter::parseColumns(input, options.columns))
+    {
+        std::cout << Color::BOLD_RED << "Error: Unknown column name." << Color::RESET << std::endl;
+        return;
+    }
+
+    std::string path;
+    std::cout << "  Output file ('-' for the screen): ";
+    std::getline(std::cin, path);
+    if (path.empty())
+    {
+        std::cout << Color::BOLD_RED << "Error: No output file given." << Color::RESET << std::endl;
+        return;
+    }
+
+    TraceSpan span("exportCatalog");
+    std::cout << std::flush; // Keep our prompts ahead of output sent straight to stdout.
+    BufferedWriter out;
+    if (!out.open(path))
+    {
+        std::cout << Color::BOLD_RED << "Error: Could not open '" << path << "' for writing." << Color::RESET << std::endl;
+        return;
+    }
+    CatalogExporter exporter(options);
+    exporter.writeHeader(out);
+    size_t exported = 0;
+    Book book; // Reused, so each title is decoded into the same buffer.
+    for (auto it = m_books.begin(); it != m_books.end(); ++it)
+    {
+        if (recordsEvicted())
+            bookFields(it.index(), book); // The stored record has its title.
+        else
+        {
+            book = *it;
+            m_title_dictionary.title(it.index(), book.title);
+        }
+        if (exporter.writeBook(book, out))
+            exported++;
+    }
+    if (!out.close())
+    {
+        std::cout << Color::BOLD_RED << "Error: Writing '" << path << "' failed." << Color::RESET << std::endl;
+        return;
     }
+    std::cout << "\n"
+              << Color::BOLD_GREEN << "Exported " << exported << " book(s)." << Color::RESET << std::endl;
+}
+
+// --- Loan Reports ---
+
+void LibraryManager::displayOverdueBooks()
+{
+    displayLoanReport("Overdue Books", 0, std::time(nullptr));
+}
+
+void LibraryManager::displayDueToday()
+{
+    std::time_t now = std::time(nullptr);
+    std::tm midnight = *std::localtime(&now);
+    midnight.tm_hour = 0;
+    midnight.tm_min = 0;
+    midnight.tm_sec = 0;
+    midnight.tm_mday += 1;
+    midnight.tm_isdst = -1;
+    displayLoanReport("Due Today", now, std::mktime(&midnight));
+}
+
+void LibraryManager::displayLoanReport(const std::string &heading, std::time_t from, std::time_t to)
+{
+    TraceSpan span("displayLoanReport");
+    std::vector<LoanTracker::Loan> loans = m_loans.dueBetween(from, to);
+
+    std::cout << "\n"
+              << Color::BOLD_CYAN << "--- " << heading << " ---" << Color::RESET << std::endl;
+    if (loans.empty())
+    {
+        std::cout << "No books to show." << std::endl;
+        return;
+    }
+
+    std::time_t now = std::time(nullptr);
+    tabulate::Table table;
+    table.add_row({"ISBN", "Title", "Borrower", "Due", "Days Overdue"});
+    Book buffer;
+    for (const auto &loan : loans)
+    {
+        const Book *book = &bookFields(loan.book, buffer);
+        long days_overdue = loan.due < now ? static_cast<long>((now - loan.due) / (24 * 60 * 60)) : 0;
+        table.add_row({book->isbn, bookTitle(loan.book), book->borrowerUsername, formatDate(loan.due), std::to_string(days_overdue)});
+        if (loan.due < now)
+            table.row(table.size() - 1).format().font_color(tabulate::Color::red);
+    }
+    table.format().border_top("=").border_bottom("=").border_left("|").border_right("|");
+    std::cout << table << std::endl;
+    std::cout << loans.size() << " book(s)." << std::endl;
+}
+
+void LibraryManager::fuzzySearchBooks()
+{
+    std::string searchTerm;
+    std::cout << "\nEnter title or author (spelling mistakes are OK): ";
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    std::getline(std::cin, searchTerm);
+    TraceSpan span("fuzzySearchBooks");
+    AllocScope alloc_scope(AllocStats::Subsystem::SEARCH);
+
+    ensureFuzzyIndex();
+    std::vector<FuzzyIndex::Match> matches = m_fuzzy_index.search(searchTerm, 20);
+    if (matches.empty())
+    {
+        std::cout << "No books found matching your search." << std::endl;
+        return;
+    }
+
+    std::cout << "\n--- Closest Matches ---\n";
+    tabulate::Table table;
+    table.add_row({"ISBN", "Title", "Author", "Status"});
+    Book buffer;
+    for (const auto &match : matches)
+    {
+        const Book &book = bookFields(match.doc, buffer);
+        table.add_row({book.isbn, bookTitle(match.doc), book.author, statusText(book)});
+    }
+    std::cout << table << std::endl;
+}
+
+// --- Mounted Branches ---
+// Other branches' catalogs are read-only copies loaded from their books files.
+// Listings and searches treat them as extra sources next to m_books; nothing
+// is copied into m_books and the home indexes never see branch books.
+
+void LibraryManager::mountBranches(const std::vector<std::pair<std::string, std::string>> &branches)
+{
+    TraceSpan span("mountBranches");
+    std::vector<std::unique_ptr<BranchCatalog>> mounting;
+    for (const auto &branch : branches)
+        mounting.push_back(std::make_unique<BranchCatalog>(branch.first, branch.second + "/books.csv"));
+
+    // Each branch is read, parsed and indexed on its own thread.
+    std::vector<char> loaded(mounting.size(), 0);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < mounting.size(); ++i)
+    {
+        workers.emplace_back([&mounting, i, &loaded]()
+                             {
+                                 AllocScope alloc_scope(AllocStats::Subsystem::CATALOG);
+                                 std::string contents;
+                                 if (!readWholeFile(mounting[i]->booksPath(), contents))
+                                     return;
+                                 std::vector<Book> books;
+                                 BookCsv::parse(contents, books);
+                                 mounting[i]->assign(std::move(books));
+                                 loaded[i] = 1;
+                             });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    // Only the branches that loaded are mounted; the others would list and search as empty.
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < mounting.size(); ++i)
+    {
+        if (!loaded[i])
+        {
+            std::cerr << Color::BOLD_RED << "ERROR: Could not open books data file of branch " << mounting[i]->name()
+                      << ": " << mounting[i]->booksPath() << "; the branch was not mounted." << Color::RESET << std::endl;
+            continue;
+        }
+        paths.push_back(mounting[i]->booksPath());
+        std::cout << Color::YELLOW << "Mounted branch " << mounting[i]->name() << " (" << mounting[i]->books().size()
+                  << " books)." << Color::RESET << std::endl;
+        m_branches.push_back(std::move(mounting[i]));
+    }
+    m_watcher.watch(paths);
+}
+
+void LibraryManager::reloadBranch(BranchCatalog &branch)
+{
+    TraceSpan span("reloadBranch");
+    AllocScope alloc_scope(AllocStats::Subsystem::CATALOG);
+    std::string contents;
+    if (!readWholeFile(branch.booksPath(), contents))
+        return;
+    std::vector<Book> books;
+    BookCsv::parse(contents, books);
+    branch.assign(std::move(books));
+    std::cout << Color::YELLOW << "Reloaded branch " << branch.name() << " (" << branch.books().size() << " books)."
+              << Color::RESET << std::endl;
+}
+
+Book LibraryManager::pageRowBook(const BookPageRow &row) const
+{
+    return row.branch == HOME_BRANCH ? bookAt(row.id) : m_branches[row.branch]->books()[row.id];
+}
+
+// Every branch is searched on its own thread while this one searches m_books,
+// then the hits are merged by score.
+void LibraryManager::searchAllBranches(const std::string &searchTerm)
+{
+    struct Ranked
+    {
+        BookPageRow row;
+        double score;
+    };
+    std::vector<Ranked> results;
+    bool truncated = false; // Some catalog had more than SEARCH_LIMIT matches.
+    {
+        TraceSpan span("searchAllBranches");
+        AllocScope alloc_scope(AllocStats::Subsystem::SEARCH);
+        ensureTextIndex(); // Before the threads start; they only read.
+        const std::string term = SearchCache::normalize(searchTerm);
+
+        std::vector<std::vector<Bm25Index::Hit>> branch_hits(m_branches.size());
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < m_branches.size(); ++i)
+        {
+            workers.emplace_back([this, i, &term, &branch_hits]()
+                                 {
+                                     AllocScope worker_scope(AllocStats::Subsystem::SEARCH);
+                                     branch_hits[i] = m_branches[i]->search(term, SEARCH_LIMIT + 1);
+                                 });
+        }
+        std::vector<Bm25Index::Hit> home_hits = rankBooks(term, SEARCH_LIMIT + 1);
+        for (auto &worker : workers)
+            worker.join();
+        auto trim = [&truncated](std::vector<Bm25Index::Hit> &hits)
+        {
+            if (hits.size() > SEARCH_LIMIT)
+            {
+                hits.resize(SEARCH_LIMIT);
+                truncated = true;
+            }
+        };
+        trim(home_hits);
+        for (auto &hits : branch_hits)
+            trim(hits);
+
+        for (const auto &hit : home_hits)
+            results.push_back({{hit.doc, bookTitle(hit.doc)}, hit.score});
+        for (uint32_t i = 0; i < m_branches.size(); ++i)
+        {
+            for (const auto &hit : branch_hits[i])
+                results.push_back({{hit.doc, m_branches[i]->books()[hit.doc].title, i}, hit.score});
+        }
+        std::stable_sort(results.begin(), results.end(), [](const Ranked &a, const Ranked &b)
+                         { return a.score > b.score; });
+    }
+
+    std::string count = "(" + std::to_string(results.size()) + " found, most relevant first)";
+    if (truncated)
+    {
+        count = "(" + std::to_string(results.size()) + " shown, most relevant first; a catalog had more than " +
+                std::to_string(SEARCH_LIMIT) + " matches)";
+    }
+    displayPaginatedBooks(
+        "Search Results, All Branches " + count, results.size(),
+        [&results](size_t start, size_t end, std::vector<BookPageRow> &rows)
+        {
+            for (size_t i = start; i < end; ++i)
+                rows.push_back(results[i].row);
+        });
+}
+
+// Pages through every branch in title order by k-way merging the per-branch
+// title views. The merge cursor is remembered at every page start it reaches,
+// so moving between pages only merges the rows in between.
+void LibraryManager::displayAllBranchesByTitle()
+{
+    const std::vector<uint32_t> &home = sortedBooks(BookSortKey::TITLE);
+    AllocScope alloc_scope(AllocStats::Subsystem::DISPLAY);
+
+    // List 0 is this branch, list i + 1 is m_branches[i].
+    std::vector<size_t> sizes = {home.size()};
+    for (const auto &branch : m_branches)
+        sizes.push_back(branch->byTitle().size());
+    size_t total = 0;
+    for (size_t size : sizes)
+        total += size;
+
+    // This branch's titles are decoded from the dictionary into `buffer`.
+    auto titleAt = [this, &home](uint32_t list, size_t index, std::string &buffer) -> const std::string &
+    {
+        if (list == 0)
+        {
+            m_title_dictionary.title(home[index], buffer);
+            return buffer;
+        }
+        const BranchCatalog &branch = *m_branches[list - 1];
+        return branch.books()[branch.byTitle()[index]].title;
+    };
+    std::string buffer_a, buffer_b;
+    // Title, then branch: the same order each list is already sorted in.
+    auto less = [&](const auto &a, const auto &b)
+    {
+        int order = titleAt(a.list, a.index, buffer_a).compare(titleAt(b.list, b.index, buffer_b));
+        if (order != 0)
+            return order < 0;
+        return a.list != b.list ? a.list < b.list : a.index < b.index;
+    };
+    using Merge = KWayMerge<decltype(less)>;
+    Merge merge(sizes, less);
+    std::map<size_t, std::vector<size_t>> cursors = {{0, std::vector<size_t>(sizes.size(), 0)}}; // Merged position -> offsets.
+
+    auto fetchPage = [&](size_t start, size_t end, std::vector<BookPageRow> &rows)
+    {
+        TraceSpan span("mergeBranchPage");
+        // Resume from the remembered cursor nearest to `start`, on either side.
+        auto after = cursors.lower_bound(start);
+        auto before = std::prev(cursors.upper_bound(start));
+        auto nearest = (after != cursors.end() && after->first - start < start - before->first) ? after : before;
+        merge.seek(nearest->second);
+        Merge::Item item;
+        while (merge.position() > start)
+            merge.previous();
+        while (merge.position() < start && merge.next(item))
+        {
+        }
+        cursors[start] = merge.offsets();
+
+        std::string title;
+        for (size_t i = start; i < end && merge.next(item); ++i)
+        {
+            uint32_t id = item.list == 0 ? home[item.index] : m_branches[item.list - 1]->byTitle()[item.index];
+            rows.push_back({id, titleAt(item.list, item.index, title), item.list == 0 ? HOME_BRANCH : item.list - 1});
+        }
+    };
+    // Each list's lower bound adds up to the merged position; the cursor there is remembered too.
+    auto findTitle = [&](const std::string &title)
+    {
+        std::vector<size_t> offsets;
+        // `home` is the dictionary's own order.
+        offsets.push_back(m_title_dictionary.lowerBound(title));
+        for (const auto &branch : m_branches)
+            offsets.push_back(branch->titleLowerBound(title));
+        merge.seek(offsets);
+        cursors[merge.position()] = offsets;
+        return merge.position();
+    };
+
+    displayPaginatedBooks("All Books, All Branches (Sorted by Title)", total, fetchPage, findTitle);
+}
+
+// --- Faceted Filtering ---
+
+void LibraryManager::ensureFacetIndex()
+{
+    if (m_facets_catalog_generation == m_catalog_generation && m_facets_circulation_generation == m_circulation_generation)
+        return;
+    TraceSpan span("buildFacetIndex");
+    AllocScope alloc_scope(AllocStats::Subsystem::FACET_INDEX);
+    m_facets.clear();
+    Book buffer;
+    for (auto it = m_books.begin(); it != m_books.end(); ++it)
+        m_facets.add(it.index(), bookFields(it.index(), buffer));
+    m_facets_catalog_generation = m_catalog_generation;
+    m_facets_circulation_generation = m_circulation_generation;
 }
 
-Book *LibraryManager::findBookByISBN(const std::string &isbn)
+void LibraryManager::filterBooks()
 {
-    for (auto &book : m_books)
+    std::string availability, authors, borrower;
+    std::cout << "\n"
+              << Color::BOLD_CYAN << "--- Filter Books ---\n"
+              << Color::RESET;
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    std::cout << "  Availability (1 any, 2 available, 3 checked out) [1]: ";
+    std::getline(std::cin, availability);
+    std::cout << "  Author (blank for any; separate several with '|'): ";
+    std::getline(std::cin, authors);
+    std::cout << "  Borrower username (blank for any): ";
+    std::getline(std::cin, borrower);
+
+    std::vector<uint32_t> ids;
     {
-        if (book.isbn == isbn)
+        TraceSpan span("filterBooks");
+        AllocScope alloc_scope(AllocStats::Subsystem::SEARCH);
+        ensureFacetIndex();
+
+        // Each facet narrows `result`; a facet left blank does not take part.
+        RoaringBitmap result;
+        bool any = true; // `result` still stands for "every book".
+        auto narrow = [&](const RoaringBitmap &facet)
+        {
+            result = any ? facet : RoaringBitmap::intersect(result, facet);
+            any = false;
+        };
+
+        if (availability == "2")
+            narrow(m_facets.available());
+        else if (availability == "3")
+            narrow(m_facets.checkedOut());
+
+        if (!authors.empty())
+        {
+            RoaringBitmap by_any_author;
+            std::stringstream list(authors);
+            std::string name;
+            while (std::getline(list, name, '|'))
+            {
+                size_t first = name.find_first_not_of(' ');
+                size_t last = name.find_last_not_of(' ');
+                if (first == std::string::npos)
+                    continue;
+                if (const RoaringBitmap *facet = m_facets.author(name.substr(first, last - first + 1)))
+                    by_any_author = RoaringBitmap::unite(by_any_author, *facet);
+            }
+            narrow(by_any_author);
+        }
+
+        if (!borrower.empty())
+        {
+            const RoaringBitmap *facet = m_facets.borrower(borrower);
+            narrow(facet != nullptr ? *facet : RoaringBitmap());
+        }
+
+        if (any)
+        {
+            ids = sortedBooks(BookSortKey::TITLE);
+        }
+        else
         {
-            return &book;
+            result.appendTo(ids);
+            ensureTitleDictionary();
+            std::sort(ids.begin(), ids.end(), [this](uint32_t a, uint32_t b)
+                      { return m_title_dictionary.compare(a, b) < 0; });
         }
     }
-    return nullptr;
+
+    displayPaginatedBooks(
+        "Filtered Books (" + std::to_string(ids.size()) + " found, by title)", ids.size(),
+        [this, &ids](size_t start, size_t end, std::vector<BookPageRow> &rows)
+        {
+            for (size_t i = start; i < end; ++i)
+                rows.push_back({ids[i], bookTitle(ids[i])});
+        });
+}
+
+// Rebuilds the fuzzy index if the catalog changed since it was built.
+// Documents are slot ids in m_books.
+void LibraryManager::ensureFuzzyIndex()
+{
+    if (m_fuzzy_index_generation == m_catalog_generation)
+        return;
+    TraceSpan span("buildFuzzyIndex");
+    AllocScope alloc_scope(AllocStats::Subsystem::FUZZY_INDEX);
+    m_fuzzy_index.clear();
+    std::string title;
+    Book buffer;
+    for (auto it = m_books.begin(); it != m_books.end(); ++it)
+    {
+        m_title_dictionary.title(it.index(), title);
+        m_fuzzy_index.addDocument(it.index(), title + " " + bookFields(it.index(), buffer).author);
+    }
+    m_fuzzy_index_generation = m_catalog_generation;
+}
+
+// Rebuilds the BM25 index if the catalog changed since it was built.
+void LibraryManager::ensureTextIndex()
+{
+    if (m_text_index_generation == m_catalog_generation)
+        return;
+    TraceSpan span("buildTextIndex");
+    AllocScope alloc_scope(AllocStats::Subsystem::TEXT_INDEX);
+    m_text_index.clear();
+    std::string title;
+    Book buffer;
+    for (auto it = m_books.begin(); it != m_books.end(); ++it)
+    {
+        m_title_dictionary.title(it.index(), title);
+        m_text_index.addDocument(it.index(), title + " " + bookFields(it.index(), buffer).author);
+    }
+    m_text_index.finalize();
+    m_text_index_generation = m_catalog_generation;
+}
+
+uint32_t LibraryManager::findBookByISBN(const std::string &isbn) const
+{
+    return m_isbn_index.find(isbn);
+}
+
+uint32_t LibraryManager::findCopy(const std::string &isbn, bool checked_out, const std::vector<uint32_t> &taken, size_t &matching) const
+{
+    uint32_t found = KeyIndex::NONE;
+    matching = 0;
+    Book buffer;
+    for (uint32_t id : m_isbn_index.findAll(isbn))
+    {
+        if (bookFields(id, buffer).isCheckedOut != checked_out)
+            continue;
+        matching++;
+        if (found == KeyIndex::NONE && std::find(taken.begin(), taken.end(), id) == taken.end())
+            found = id;
+    }
+    return found;
 }
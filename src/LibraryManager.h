@@ -3,46 +3,305 @@
 
 #include "Book.h"
 #include "User.h"
+#include "PersistenceWriter.h"
+#include "BookPageStore.h"
+#include "DataFileWatcher.h"
+#include "FuzzyIndex.h"
+#include "Bm25Index.h"
+#include "SearchCache.h"
+#include "TitleDictionary.h"
+#include "HoldQueue.h"
+#include "KeyIndex.h"
+#include "LoanTracker.h"
+#include "SlotMap.h"
+#include "SharedCatalog.h"
+#include "FacetIndex.h"
+#include "BranchCatalog.h"
+#include "ReplicationServer.h"
+#include "ReplicationClient.h"
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
 
 // This class handles all the backend logic.
 class LibraryManager
 {
 public:
     // --- Constructor ---
-    LibraryManager(const std::string &books_path, const std::string &users_path);
+    // With `load_books` false the books file is left unread until enableSharedCatalog
+    // knows whether it is needed (it is not when the segment already exists).
+    LibraryManager(const std::string &books_path, const std::string &users_path, const std::string &holds_path,
+                   bool load_books = true);
+
+    // Saves are written in the background; call this before logout/exit.
+    // Returns false (after reporting it) if a data file could not be written.
+    bool flushPendingWrites();
+
+    // Optional B+tree page file that takes over the book records, one per copy.
+    // Once enabled, records are read through its buffer pool and m_books keeps
+    // only their keys; a change is an in-place page update made durable at once,
+    // and the books file becomes an export written on flushPendingWrites. On
+    // enable the page file is brought in line with the books file, unless it
+    // holds changes the books file never got (the last session did not export
+    // them), in which case the books file is restored from it instead. Refuses
+    // (returns false) if a book does not fit a page record.
+    bool enablePageStore(const std::string &path, size_t pool_pages);
+
+    // Optional POSIX shared-memory catalog shared by every desk on this host. The first
+    // process creates it from its books file; later ones attach without reading the
+    // file. The segment then holds the records (m_books keeps their keys), every
+    // change is published to it record by record, and the books file becomes an
+    // export written on flushPendingWrites. Cannot be combined with the page store.
+    bool enableSharedCatalog(const std::string &name, size_t capacity);
+
+    // Optional replication over a Unix domain socket. A primary streams every change
+    // to the catalog; a replica follows a primary, keeps its own in-memory copy
+    // and only serves the read-only menus, so reporting load stays off the primary.
+    bool enableReplicationPrimary(const std::string &socket_path);
+    bool enableReplica(const std::string &socket_path);
+    bool isReplica() const { return m_replication_client.isRunning(); }
+    void displayReplicationStatus();
+
+    // Mounts other branches' catalogs read-only, given as (name, data directory) pairs;
+    // each directory holds that branch's books.csv. Title listings and searches then
+    // span every branch. Circulation still only happens on our own catalog. A branch
+    // whose books file cannot be read is reported and left unmounted.
+    void mountBranches(const std::vector<std::pair<std::string, std::string>> &branches);
+
+    // Picks up edits other programs made to the data files (and the shared
+    // catalog or the replication stream, if enabled). Call once per menu loop.
+    void pollDataFiles();
+
+    // Refers to a user record; goes stale (findUser returns nullptr) once the user is removed.
+    using UserHandle = SlotMap<User>::Handle;
 
     // --- Public User Management Functions ---
-    User *validateUser(const std::string &username, const std::string &password);
+    UserHandle validateUser(const std::string &username, const std::string &password);
+    const User *findUser(UserHandle handle) const;
     void addUser();
     void removeUser();
     void displayAllUsers();
     void searchUserByUsername();
+    void displaySearchCacheStats();
+    void setSearchCacheBudget(size_t bytes);
+    void displayMemoryReport();
 
     // --- Public Book Management Functions ---
     void addBook();
     void displayAllBooks();
     void checkOutBook();
     void returnBook();
+    // Several ISBNs at once: validated together, applied all-or-nothing, saved once.
+    void checkOutBasket();
+    void returnBasket();
+    void cancelHold();
     void searchBookByTitle();
+    void fuzzySearchBooks();
     void removeBook();
+    void exportCatalog();
+    void displayOverdueBooks();
+    void displayDueToday();
+    // Availability, author and borrower filters combined, answered from the facet bitmaps.
+    void filterBooks();
 
 private:
+    static const uint32_t HOME_BRANCH = UINT32_MAX;
+    static const size_t SEARCH_LIMIT = 50; // Ranked search results listed per catalog.
+    // One row of a paginated book listing: the record's slot id in m_books (or its
+    // index in a mounted branch's books) and the title to show.
+    struct BookPageRow
+    {
+        uint32_t id;
+        std::string title;
+        uint32_t branch = HOME_BRANCH; // Index into m_branches.
+    };
+    // Fills `rows` with listing positions [start, end).
+    using BookPageSource = std::function<void(size_t start, size_t end, std::vector<BookPageRow> &rows)>;
+
+    enum class BookSortKey
+    {
+        TITLE,
+        AUTHOR,
+        AVAILABILITY,
+        BORROWER,
+        COUNT
+    };
+    // The orders that depend on loans, which also go stale on circulation changes.
+    static bool sortUsesCirculation(BookSortKey key) { return key == BookSortKey::AVAILABILITY || key == BookSortKey::BORROWER; }
+    // A cached permutation of book slot ids and the generations it was sorted at.
+    struct SortedView
+    {
+        std::vector<uint32_t> ids;
+        uint64_t catalog_generation = UINT64_MAX;
+        uint64_t circulation_generation = UINT64_MAX;
+    };
+
     // --- Private Helper Functions (Internal use only) ---
     void loadBooks();
     void saveBooks();
     void loadUsers();
     void saveUsers();
-    Book *findBookByISBN(const std::string &isbn);
-    void displayPaginatedBooks(const std::vector<Book> &books);
-    void displayPaginatedUsers(const std::vector<User> &users); // <-- Added this line
+    void loadHolds();
+    void saveHolds();
+    void mergeExternalBooks();
+    void mergeExternalUsers();
+    // Follow-up for the ISBNs a merge touched: drops holds on removed books and ships the changes to replicas.
+    void applyBookChanges(const std::vector<std::string> &touched);
+    // Applies what other desks changed in the shared catalog since we last looked.
+    void refreshFromSharedCatalog();
+    // Rebuilds m_books from the whole segment, after attaching or when the change log overflowed.
+    bool resyncFromSharedCatalog();
+    // Brings m_books, the ISBN index, titles and loans in line with other desks'
+    // changes; the other indexes are marked stale and rebuild from the segment when next used.
+    void applySharedChanges(const std::vector<SharedCatalog::Change> &changes);
+    // Applies `edits` to the segment under its writer lock, after applying what other
+    // desks changed before them. Reports and returns false if they were refused; then
+    // nothing was changed.
+    bool publishToSharedCatalog(std::vector<SharedCatalog::Edit> &edits);
+    // Appends the change of one record to m_journal (REMOVE: only the key of `book` is used).
+    void journalBookChange(ReplicationEvent::Kind kind, const Book &book);
+    // Ships m_journal to replicas, and a new snapshot once the server's log has grown long.
+    void shipJournal();
+    // The record of a SNAPSHOT event: every copy id, then the catalog in books-file format.
+    std::string formatSnapshot() const;
+    void applyReplicationEvents();
+    // Slot id of the first copy of `isbn`, or KeyIndex::NONE.
+    uint32_t findBookByISBN(const std::string &isbn) const;
+    // A copy of `isbn` that is (or, with `checked_out` false, is not) on loan and is
+    // not in `taken`, or KeyIndex::NONE. `matching` counts every copy in that state.
+    uint32_t findCopy(const std::string &isbn, bool checked_out, const std::vector<uint32_t> &taken, size_t &matching) const;
+    // Records in m_books keep an empty title; it lives in m_title_dictionary under the slot id.
+    // With the page store or the shared catalog open they keep nothing but their key (ISBN and copy id).
+    bool recordsEvicted() const { return m_page_store.isOpen() || m_shared_catalog.isOpen(); }
+    // Slot id of copy `copy_id` of `isbn`, or KeyIndex::NONE.
+    uint32_t locateBook(const std::string &isbn, int copy_id) const;
+    std::string bookTitle(uint32_t id) const;
+    // A copy of book `id` with its title filled in (read from wherever the records are held).
+    Book bookAt(uint32_t id) const;
+    // Book `id` for reading everything but its title: the record in m_books
+    // itself, or, if records are evicted, a copy read into `buffer`.
+    const Book &bookFields(uint32_t id, Book &buffer) const;
+    // Every book with its title, in slot order.
+    std::vector<Book> catalogBooks() const;
+    // m_books in books-file format.
+    std::string formatCatalog() const;
+    // --- Record layer ---
+    // Every change to a record in m_books goes through these, so the indexes over
+    // m_books (and the page store or shared catalog, when one holds the records)
+    // can be patched one record at a time instead of rebuilt. With a shared
+    // catalog a change can be refused (another desk changed the record first, or
+    // the segment is full): then it is reported, nothing changes, and insertBook
+    // returns KeyIndex::NONE and the others false.
+    // The new record gets the next free copy id of its ISBN unless `assign_copy_id`
+    // is false (a replica keeps the one the primary assigned).
+    uint32_t insertBook(const Book &book, bool assign_copy_id = true);
+    // `expected` is the record as the caller read it; with a shared catalog the
+    // update is refused if another desk has changed it since.
+    bool updateBook(uint32_t id, const Book &book, const Book *expected = nullptr);
+    // Several records, all or none (a basket): all are checked before any changes.
+    bool updateBooks(const std::vector<uint32_t> &ids, const std::vector<Book> &books, const std::vector<Book> &expected);
+    bool eraseBook(uint32_t id);
+    // Writes `book` into record `id` (or through to the page store), leaving the title to the dictionary.
+    void storeBook(uint32_t id, const Book &book);
+    // Bumps the generation that a change to book `id` affects, patches every index
+    // that was current (ISBN index, facets, text and fuzzy indexes, sorted views,
+    // loans), and journals the change for replicas.
+    // `before` is null for an added book, `after` for a removed one.
+    void noteBookChange(uint32_t id, const Book *before, const Book *after);
+    // After m_books was replaced wholesale (records still carrying their titles):
+    // moves the titles into the dictionary, rebuilds the ISBN index and loans, and
+    // leaves the other indexes to rebuild when next used. Copies of an ISBN are
+    // numbered in slot order unless `number_copies` is false.
+    void reindexBooks(bool number_copies = true);
+    // Drops everything but the key from each record in m_books, once the page store or shared catalog holds them.
+    void evictBooks();
+    // mergeRecords' view of m_books; applies each change through the record layer.
+    struct CatalogTable;
+    void ensureFacetIndex();
+    User *verifyIdentity(const std::string &purpose, const std::string &cancelled_message);
+    void placeHold(uint32_t id);
+    // Lists loans due in [from, to), soonest first.
+    void displayLoanReport(const std::string &heading, std::time_t from, std::time_t to);
+    // Up to `limit` ranked matches in m_books for a normalized search term, best first
+    // (see searchBookByTitle).
+    std::vector<Bm25Index::Hit> rankBooks(const std::string &term, size_t limit);
+    void searchAllBranches(const std::string &searchTerm);
+    void displayAllBranchesByTitle();
+    void reloadBranch(BranchCatalog &branch);
+    Book pageRowBook(const BookPageRow &row) const;
+    void ensureFuzzyIndex();
+    void ensureTextIndex();
+    // findTitle (optional) maps a title to its listing position, enabling [J]ump.
+    void displayPaginatedBooks(const std::string &heading, size_t record_count, const BookPageSource &fetchPage,
+                               const std::function<size_t(const std::string &)> &findTitle = nullptr);
+    // Merges pending title changes in, so the dictionary can be paged by position.
+    void ensureTitleDictionary();
+    const std::vector<uint32_t> &sortedBooks(BookSortKey key);
+    // Whether book `a` (fields `x`, see bookFields) comes before book `b` (fields `y`) in `key` order.
+    bool booksInOrder(BookSortKey key, uint32_t a, const Book &x, uint32_t b, const Book &y) const;
+    void displayPaginatedUsers(const std::string &heading, const std::vector<uint32_t> &users); // User slot ids in display order.
 
     // --- Private Properties ---
     std::string m_books_filepath;
     std::string m_users_filepath;
-    std::vector<Book> m_books;
-    std::vector<User> m_users;
+    std::string m_holds_filepath;
+    SlotMap<Book> m_books; // Slot ids are the document ids used by every book index.
+    KeyIndex m_isbn_index; // ISBN -> slot ids in m_books; always current.
+    SlotMap<User> m_users;
+    HoldQueue m_holds;
+    LoanTracker m_loans; // Due dates of the books currently checked out.
+    mutable BookPageStore m_page_store; // Reading a record moves pages through its buffer pool.
+    DataFileWatcher m_watcher;
+    SharedCatalog m_shared_catalog;
+    bool m_books_loaded = false;
+    bool m_books_unexported = false; // Published to the shared catalog but not yet exported to the books file.
+    ReplicationServer m_replication_server;
+    std::vector<ReplicationEvent> m_journal; // Record changes not yet shipped to replicas.
+    ReplicationClient m_replication_client;
+    // Replica side: how far we have followed the primary.
+    struct ReplicaProgress
+    {
+        uint64_t applied_seq = 0;
+        uint64_t primary_seq = 0;      // Newest seq the primary has told us about.
+        int64_t last_heartbeat_us = 0; // Primary's clock at its last heartbeat.
+        int64_t last_lag_us = 0;       // Created on the primary -> received here, for the last event.
+        int64_t max_lag_us = 0;
+        int64_t last_apply_delay_us = 0; // Received here -> applied, for the last event.
+        int64_t max_apply_delay_us = 0;
+        uint64_t events_applied = 0;
+        uint64_t snapshots_loaded = 0;
+    };
+    ReplicaProgress m_replica;
+
+    // Bumped whenever books are added to or removed from m_books, or their title or author changes.
+    // Indexes over m_books remember the generation they were built at.
+    uint64_t m_catalog_generation = 0;
+    uint64_t m_books_load_allocations = 0; // Heap allocations made by the last loadBooks().
+    FuzzyIndex m_fuzzy_index;
+    uint64_t m_fuzzy_index_generation = UINT64_MAX;
+    Bm25Index m_text_index;
+    uint64_t m_text_index_generation = UINT64_MAX;
+    TitleDictionary m_title_dictionary; // Every title in m_books, front-coded in display order; always current.
+    // Bumped on every other change to a book (checkouts, returns, hold hand-offs).
+    uint64_t m_circulation_generation = 0;
+    SortedView m_book_views[static_cast<size_t>(BookSortKey::COUNT)];
+    std::vector<std::unique_ptr<BranchCatalog>> m_branches; // Mounted read-only.
+    // Kept current by noteBookChange; rebuilt after bulk loads and merges.
+    FacetIndex m_facets;
+    uint64_t m_facets_catalog_generation = UINT64_MAX;
+    uint64_t m_facets_circulation_generation = UINT64_MAX;
+
+    // Same idea for m_users: bumped on every add, remove or reload.
+    uint64_t m_users_generation = 0;
+    std::vector<uint32_t> m_users_by_name;
+    uint64_t m_users_by_name_generation = UINT64_MAX;
+    // Query -> result slot ids, valid while the matching generation is unchanged.
+    // Checkouts and returns do not invalidate it: results carry slot ids, not status.
+    SearchCache m_search_cache;
+    PersistenceWriter m_writer;
 };
 
 #endif // LIBRARYMANAGER_H
@@ -0,0 +1,41 @@
+#include "LoanTracker.h"
+
+void LoanTracker::clear()
+{
+    m_by_due.clear();
+    m_due.clear();
+}
+
+void LoanTracker::track(uint32_t book, std::time_t due)
+{
+    auto it = m_due.find(book);
+    if (it != m_due.end())
+    {
+        if (it->second == due)
+            return;
+        m_by_due.erase({it->second, book});
+        it->second = due;
+    }
+    else
+    {
+        m_due.emplace(book, due);
+    }
+    m_by_due.insert({due, book});
+}
+
+void LoanTracker::untrack(uint32_t book)
+{
+    auto it = m_due.find(book);
+    if (it == m_due.end())
+        return;
+    m_by_due.erase({it->second, book});
+    m_due.erase(it);
+}
+
+std::vector<LoanTracker::Loan> LoanTracker::dueBetween(std::time_t from, std::time_t to) const
+{
+    std::vector<Loan> loans;
+    for (auto it = m_by_due.lower_bound({from, 0}); it != m_by_due.end() && it->first < to; ++it)
+        loans.push_back({it->second, it->first});
+    return loans;
+}
@@ -0,0 +1,42 @@
+#ifndef LOANTRACKER_H
+#define LOANTRACKER_H
+
+#include <cstdint>
+#include <ctime>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Outstanding loans ordered by due date.
+// Loans are keyed by the book's slot id, so every copy of an ISBN has its own.
+// They sit in a balanced search tree ordered by (due date, slot id), and every
+// book knows its due date, so loans can be added, moved or removed in
+// O(log n). A report for [from, to) seeks to `from` and stops at `to`, so it
+// costs O(log n + result) rather than a scan of the catalog or of every loan
+// due before `to`.
+class LoanTracker
+{
+public:
+    struct Loan
+    {
+        uint32_t book; // Slot id in the catalog.
+        std::time_t due;
+    };
+
+    void clear();
+    // Adds the loan, or moves it if the book is already tracked.
+    void track(uint32_t book, std::time_t due);
+    void untrack(uint32_t book);
+
+    // Loans due in [from, to), soonest first.
+    std::vector<Loan> dueBetween(std::time_t from, std::time_t to) const;
+
+    size_t size() const { return m_due.size(); }
+
+private:
+    std::set<std::pair<std::time_t, uint32_t>> m_by_due;
+    std::unordered_map<uint32_t, std::time_t> m_due; // book -> due date
+};
+
+#endif // LOANTRACKER_H
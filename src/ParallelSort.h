@@ -0,0 +1,75 @@
+#ifndef PARALLELSORT_H
+#define PARALLELSORT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Stable sort of a permutation of record ids, spread over the hardware threads.
+// The ids are cut into one run per thread, each run is std::stable_sort-ed on
+// its own thread, then neighbouring runs are merged pairwise (also in parallel)
+// until one run is left. std::merge prefers the left run on ties, so the result
+// is stable. Small inputs are sorted on the calling thread.
+// `less` is called concurrently and must only read shared state.
+template <typename Less>
+void parallelStableSort(std::vector<uint32_t> &ids, Less less)
+{
+    const size_t MIN_RUN = 4096;
+    size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    size_t runs = std::min(threads, ids.size() / MIN_RUN);
+    if (runs < 2)
+    {
+        std::stable_sort(ids.begin(), ids.end(), less);
+        return;
+    }
+
+    // bounds[i]..bounds[i+1] is run i.
+    std::vector<size_t> bounds(runs + 1);
+    for (size_t i = 0; i <= runs; ++i)
+        bounds[i] = ids.size() * i / runs;
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < runs; ++i)
+    {
+        workers.emplace_back([&, i]()
+                             { std::stable_sort(ids.begin() + bounds[i], ids.begin() + bounds[i + 1], less); });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    std::vector<uint32_t> scratch(ids.size());
+    std::vector<uint32_t> *from = &ids;
+    std::vector<uint32_t> *to = &scratch;
+    while (bounds.size() > 2)
+    {
+        std::vector<size_t> merged_bounds;
+        workers.clear();
+        for (size_t i = 0; i + 1 < bounds.size(); i += 2)
+        {
+            merged_bounds.push_back(bounds[i]);
+            if (i + 2 < bounds.size())
+            {
+                size_t begin = bounds[i], middle = bounds[i + 1], end = bounds[i + 2];
+                workers.emplace_back([=, &less]()
+                                     { std::merge(from->begin() + begin, from->begin() + middle, from->begin() + middle,
+                                                  from->begin() + end, to->begin() + begin, less); });
+            }
+            else
+            {
+                // Odd run out: carried over unchanged.
+                std::copy(from->begin() + bounds[i], from->begin() + bounds[i + 1], to->begin() + bounds[i]);
+            }
+        }
+        merged_bounds.push_back(bounds.back());
+        for (auto &worker : workers)
+            worker.join();
+        bounds.swap(merged_bounds);
+        std::swap(from, to);
+    }
+    if (from != &ids)
+        ids.swap(scratch);
+}
+
+#endif // PARALLELSORT_H
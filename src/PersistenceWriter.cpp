@@ -0,0 +1,201 @@
+#include "PersistenceWriter.h"
+
+#include <cerrno>
+#include <chrono>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "colors.hpp"
+#include "Trace.h"
+
+namespace
+{
+    // How long to wait before writing a file again after a failed write.
+    const int RETRY_MS = 2000;
+}
+
+PersistenceWriter::PersistenceWriter(int debounce_ms)
+    : m_debounce_ms(debounce_ms)
+{
+    m_thread = std::thread(&PersistenceWriter::run, this);
+}
+
+PersistenceWriter::~PersistenceWriter()
+{
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_work_cv.notify_one();
+    m_thread.join();
+}
+
+void PersistenceWriter::submit(const std::string &path, std::string contents)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending[path] = std::move(contents);
+    }
+    m_work_cv.notify_one();
+}
+
+bool PersistenceWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_pending.empty() && !m_writing)
+        return true;
+    // Everything pending now goes into the next batch to start; once that batch
+    // has finished we know whether it all reached the disk.
+    const uint64_t batch = m_batches_started + 1;
+    m_flush_requested = true;
+    m_work_cv.notify_one();
+    m_idle_cv.wait(lock, [this, batch]
+                   { return !m_writing && (m_pending.empty() || m_batches_finished >= batch); });
+    return m_pending.empty();
+}
+
+void PersistenceWriter::noteOnDisk(const std::string &path, const std::string &contents)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_on_disk[path] = contents;
+}
+
+std::string PersistenceWriter::lastOnDisk(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_on_disk.find(path);
+    return (it == m_on_disk.end()) ? std::string() : it->second;
+}
+
+bool PersistenceWriter::isOwnWrite(const std::string &path, const std::string &contents)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto on_disk = m_on_disk.find(path);
+    if (on_disk != m_on_disk.end() && on_disk->second == contents)
+        return true;
+    auto renaming = m_renaming.find(path);
+    return renaming != m_renaming.end() && renaming->second == contents;
+}
+
+void PersistenceWriter::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_work_cv.wait(lock, [this]
+                       { return m_stop || !m_pending.empty(); });
+        if (m_pending.empty())
+            return; // Only reachable when stopping with nothing left to write.
+
+        // Debounce: give further saves a chance to land in the same write,
+        // unless someone is already waiting on a flush. After a failure, back off.
+        int delay_ms = m_failed.empty() ? m_debounce_ms : RETRY_MS;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(delay_ms);
+        m_work_cv.wait_until(lock, deadline, [this]
+                             { return m_stop || m_flush_requested; });
+
+        std::map<std::string, std::string> batch;
+        batch.swap(m_pending);
+        m_flush_requested = false;
+        m_writing = true;
+        m_batches_started++;
+        lock.unlock();
+
+        std::map<std::string, std::string> failed;
+        for (auto &entry : batch)
+        {
+            if (!writeFileAtomically(entry.first, entry.second))
+                failed.insert(std::move(entry));
+        }
+
+        lock.lock();
+        std::set<std::string> previously_failed;
+        previously_failed.swap(m_failed);
+        for (auto &entry : failed)
+        {
+            // Report a file once when it starts failing, not on every retry.
+            if (previously_failed.count(entry.first) == 0)
+            {
+                std::cerr << Color::BOLD_RED << "ERROR: Could not write data file: " << entry.first
+                          << " (will keep retrying)" << Color::RESET << std::endl;
+            }
+            m_failed.insert(entry.first);
+            // Contents submitted while we were writing are newer; keep those instead.
+            m_pending.emplace(entry.first, std::move(entry.second));
+        }
+        m_writing = false;
+        m_batches_finished++;
+        m_idle_cv.notify_all();
+        if (m_stop && !failed.empty())
+            return; // Shutting down: flush() has already reported what could not be written.
+    }
+}
+
+// Writes to a temp file and renames it over the target. The new contents only become
+// "on disk" once the rename succeeded; while it is under way they are kept in
+// m_renaming, so a change notification that races the rename is still recognised
+// as our own write (isOwnWrite).
+bool PersistenceWriter::writeFileAtomically(const std::string &path, const std::string &contents)
+{
+    TraceSpan span("writeFileAtomically");
+    const std::string temp_path = path + ".tmp";
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+    // The rename replaces the file, so carry its permissions over to the new one.
+    struct stat existing;
+    if (::stat(path.c_str(), &existing) == 0)
+        ::fchmod(fd, existing.st_mode & 07777);
+
+    const char *data = contents.data();
+    size_t remaining = contents.size();
+    while (remaining > 0)
+    {
+        ssize_t written = ::write(fd, data, remaining);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            ::close(fd);
+            ::unlink(temp_path.c_str());
+            return false;
+        }
+        data += written;
+        remaining -= static_cast<size_t>(written);
+    }
+
+    if (::fsync(fd) != 0 || ::close(fd) != 0)
+    {
+        ::unlink(temp_path.c_str());
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_renaming[path] = contents;
+    }
+    bool renamed = ::rename(temp_path.c_str(), path.c_str()) == 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (renamed)
+            m_on_disk[path].swap(m_renaming[path]);
+        m_renaming.erase(path);
+    }
+    if (!renamed)
+    {
+        ::unlink(temp_path.c_str());
+        return false;
+    }
+
+    // Make the rename itself durable.
+    size_t slash = path.find_last_of('/');
+    std::string dir = (slash == std::string::npos) ? "." : path.substr(0, slash == 0 ? 1 : slash);
+    int dir_fd = ::open(dir.c_str(), O_RDONLY);
+    if (dir_fd >= 0)
+    {
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef PERSISTENCEWRITER_H
+#define PERSISTENCEWRITER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+// Background writer for the data files.
+// Callers hand over the complete new contents of a file and return immediately.
+// A persistence thread waits a short debounce interval so a burst of changes
+// collapses into a single write, then replaces each file crash-safely
+// (temp file + fsync + rename), so a crash leaves either the old or the new file.
+// A write that fails is kept and retried until it succeeds or newer contents
+// for the same file replace it.
+class PersistenceWriter
+{
+public:
+    explicit PersistenceWriter(int debounce_ms = 200);
+    ~PersistenceWriter(); // Flushes anything still pending.
+
+    PersistenceWriter(const PersistenceWriter &) = delete;
+    PersistenceWriter &operator=(const PersistenceWriter &) = delete;
+
+    // Queues the new contents of a file. Replaces any not-yet-written contents for the same path.
+    void submit(const std::string &path, std::string contents);
+
+    // Blocks until everything submitted so far is on disk, retrying failed writes once
+    // more right away. Returns false if a file still could not be written; its contents
+    // stay queued and are retried in the background.
+    bool flush();
+
+    // The contents this program last read from or wrote to a file. Used as the
+    // common base when merging changes other programs made to the same file.
+    void noteOnDisk(const std::string &path, const std::string &contents);
+    std::string lastOnDisk(const std::string &path);
+    // Whether `contents` is what this program last wrote to `path`, or is renaming
+    // over it right now, so a change notification for it is not another program's edit.
+    bool isOwnWrite(const std::string &path, const std::string &contents);
+
+private:
+    void run();
+    bool writeFileAtomically(const std::string &path, const std::string &contents);
+
+    int m_debounce_ms;
+    std::mutex m_mutex;
+    std::condition_variable m_work_cv;
+    std::condition_variable m_idle_cv;
+    std::map<std::string, std::string> m_pending;
+    std::map<std::string, std::string> m_on_disk;
+    std::map<std::string, std::string> m_renaming; // Contents whose rename is under way, by path.
+    std::set<std::string> m_failed; // Paths the last batch could not write.
+    uint64_t m_batches_started = 0;
+    uint64_t m_batches_finished = 0;
+    bool m_writing = false;
+    bool m_flush_requested = false;
+    bool m_stop = false;
+    std::thread m_thread;
+};
+
+#endif // PERSISTENCEWRITER_H
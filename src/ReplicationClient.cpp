@@ -0,0 +1,161 @@
+#include "ReplicationClient.h"
+
+#ifdef __linux__
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+    const int RECONNECT_MS = 1000;
+    const int POLL_MS = 200; // How quickly stop() is noticed.
+
+    int64_t nowMicros()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+    int connectTo(const std::string &socket_path)
+    {
+        sockaddr_un address{};
+        if (socket_path.size() >= sizeof(address.sun_path))
+            return -1;
+        address.sun_family = AF_UNIX;
+        std::strcpy(address.sun_path, socket_path.c_str());
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+        return fd;
+    }
+}
+
+ReplicationClient::~ReplicationClient()
+{
+    stop();
+}
+
+bool ReplicationClient::start(const std::string &socket_path)
+{
+    stop();
+    sockaddr_un address{};
+    if (socket_path.size() >= sizeof(address.sun_path))
+        return false;
+    m_socket_path = socket_path;
+    m_stop = false;
+    m_thread = std::thread(&ReplicationClient::run, this);
+    return true;
+}
+
+void ReplicationClient::stop()
+{
+    if (!m_thread.joinable())
+        return;
+    m_stop = true;
+    m_thread.join();
+}
+
+void ReplicationClient::drain(std::vector<ReplicationEvent> &events)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &event : m_queue)
+        events.push_back(std::move(event));
+    m_queue.clear();
+}
+
+void ReplicationClient::run()
+{
+    while (!m_stop)
+    {
+        int fd = connectTo(m_socket_path);
+        if (fd < 0)
+        {
+            for (int waited = 0; waited < RECONNECT_MS && !m_stop; waited += POLL_MS)
+                std::this_thread::sleep_for(std::chrono::milliseconds(POLL_MS));
+            continue;
+        }
+        m_connected = true;
+
+        std::string buffer;
+        char chunk[64 * 1024];
+        while (!m_stop)
+        {
+            pollfd readable = {fd, POLLIN, 0};
+            if (poll(&readable, 1, POLL_MS) <= 0)
+                continue;
+            ssize_t got = read(fd, chunk, sizeof(chunk));
+            if (got <= 0)
+                break; // Primary went away; reconnect and start over from its snapshot.
+            buffer.append(chunk, static_cast<size_t>(got));
+            decodeFrames(buffer);
+        }
+        ::close(fd);
+        m_connected = false;
+    }
+}
+
+void ReplicationClient::decodeFrames(std::string &buffer)
+{
+    std::vector<ReplicationEvent> decoded;
+    const int64_t now = nowMicros();
+    size_t offset = 0;
+    while (true)
+    {
+        size_t header_end = buffer.find('\n', offset);
+        if (header_end == std::string::npos)
+            break;
+        std::istringstream header(buffer.substr(offset, header_end - offset));
+        std::string kind_name;
+        size_t record_length = 0;
+        ReplicationEvent event;
+        header >> kind_name >> event.seq >> event.timestamp_us >> event.copy_id >> record_length;
+        if (!header || !ReplicationEvent::kindFromName(kind_name, event.kind))
+        {
+            // Not our protocol; drop the line rather than stall on it forever.
+            offset = header_end + 1;
+            continue;
+        }
+        if (buffer.size() - (header_end + 1) < record_length)
+            break; // Record not fully received yet.
+        event.record = buffer.substr(header_end + 1, record_length);
+        event.received_us = now;
+        offset = header_end + 1 + record_length;
+        decoded.push_back(std::move(event));
+    }
+    buffer.erase(0, offset);
+
+    if (!decoded.empty())
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto &event : decoded)
+            m_queue.push_back(std::move(event));
+    }
+}
+
+#else // !__linux__
+
+ReplicationClient::~ReplicationClient() {}
+
+bool ReplicationClient::start(const std::string &)
+{
+    return false;
+}
+
+void ReplicationClient::stop() {}
+
+void ReplicationClient::drain(std::vector<ReplicationEvent> &) {}
+
+void ReplicationClient::run() {}
+
+void ReplicationClient::decodeFrames(std::string &) {}
+
+#endif // __linux__
@@ -0,0 +1,47 @@
+#ifndef REPLICATIONCLIENT_H
+#define REPLICATIONCLIENT_H
+
+#include "ReplicationEvent.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Replica side of the replication stream.
+// A background thread keeps a connection to the primary's socket (retrying
+// while the primary is down), decodes the events it sends and queues them.
+// The owner drains the queue at a convenient point, so events are applied on
+// the owner's thread. Linux only; elsewhere start() returns false.
+class ReplicationClient
+{
+public:
+    ReplicationClient() = default;
+    ~ReplicationClient();
+
+    ReplicationClient(const ReplicationClient &) = delete;
+    ReplicationClient &operator=(const ReplicationClient &) = delete;
+
+    bool start(const std::string &socket_path);
+    void stop();
+    bool isRunning() const { return m_thread.joinable(); }
+    bool isConnected() const { return m_connected.load(); }
+
+    // Moves every event received since the last call into `events`, oldest first.
+    void drain(std::vector<ReplicationEvent> &events);
+
+private:
+    void run();
+    // Decodes every complete frame at the front of `buffer` into the queue,
+    // stamping each with the time it was read.
+    void decodeFrames(std::string &buffer);
+
+    std::string m_socket_path;
+    std::mutex m_mutex;
+    std::vector<ReplicationEvent> m_queue;
+    std::atomic<bool> m_stop{false};
+    std::atomic<bool> m_connected{false};
+    std::thread m_thread;
+};
+
+#endif // REPLICATIONCLIENT_H
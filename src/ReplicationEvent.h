@@ -0,0 +1,53 @@
+#ifndef REPLICATIONEVENT_H
+#define REPLICATIONEVENT_H
+
+#include <cstdint>
+#include <string>
+
+// One message on the primary -> replica stream. A plain data container, like Book.
+// On the socket each event is a header line followed by the record bytes:
+//   <kind name> <seq> <timestamp_us> <copy id> <record length>\n<record>
+// Events name a book by ISBN and copy id, which stays the same for the life of
+// the copy, so they hit the same copy on both sides whatever the slot order.
+struct ReplicationEvent
+{
+    enum class Kind
+    {
+        SNAPSHOT,  // `record` is a line with every book's copy id, then a whole books file
+                   // in the same order; replaces the replica's catalog.
+        ADD,       // `record` is one books-file line.
+        UPDATE,    // Title/author edits and anything else that is not circulation.
+        CHECKOUT,
+        RETURN,
+        REMOVE,    // `record` is the ISBN only.
+        HEARTBEAT  // No record; tells the replica how far the primary has got.
+    };
+
+    Kind kind = Kind::HEARTBEAT;
+    uint64_t seq = 0;          // Position in the primary's stream; a snapshot carries the seq it is current to.
+    int64_t timestamp_us = 0;  // Primary's wall clock when the event was created.
+    int copy_id = 0;           // Which copy of the ISBN (books files may repeat ISBNs).
+    std::string record;
+    int64_t received_us = 0;   // Replica's wall clock when the frame was read off the socket; not sent.
+
+    static const char *kindName(Kind kind)
+    {
+        static const char *const NAMES[] = {"SNAPSHOT", "ADD", "UPDATE", "CHECKOUT", "RETURN", "REMOVE", "HEARTBEAT"};
+        return NAMES[static_cast<int>(kind)];
+    }
+
+    static bool kindFromName(const std::string &name, Kind &kind)
+    {
+        for (int i = 0; i <= static_cast<int>(Kind::HEARTBEAT); ++i)
+        {
+            if (name == kindName(static_cast<Kind>(i)))
+            {
+                kind = static_cast<Kind>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+#endif // REPLICATIONEVENT_H
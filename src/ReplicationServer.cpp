@@ -0,0 +1,265 @@
+#include "ReplicationServer.h"
+
+#ifdef __linux__
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+    // A replica this far behind is dropped rather than buffered without bound.
+    const size_t MAX_PENDING_BYTES = 64 * 1024 * 1024;
+    // Past this many logged events a new replica is better off with a fresh snapshot.
+    const size_t MAX_LOG_EVENTS = 4096;
+    const int HEARTBEAT_MS = 1000;
+
+    int64_t nowMicros()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void appendFrame(std::string &out, const ReplicationEvent &event)
+    {
+        out += ReplicationEvent::kindName(event.kind);
+        out += ' ' + std::to_string(event.seq) + ' ' + std::to_string(event.timestamp_us) + ' ' +
+               std::to_string(event.copy_id) + ' ' + std::to_string(event.record.size()) + '\n';
+        out += event.record;
+    }
+
+    void setNonBlocking(int fd)
+    {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+}
+
+ReplicationServer::~ReplicationServer()
+{
+    stop();
+}
+
+bool ReplicationServer::start(const std::string &socket_path, const std::string &snapshot)
+{
+    stop();
+    sockaddr_un address{};
+    if (socket_path.size() >= sizeof(address.sun_path))
+        return false;
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, socket_path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    unlink(socket_path.c_str()); // Left behind by a primary that did not shut down cleanly.
+    if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(fd, 8) != 0 ||
+        pipe2(m_wake_pipe, O_CLOEXEC | O_NONBLOCK) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    setNonBlocking(fd);
+
+    m_socket_path = socket_path;
+    m_listen_fd = fd;
+    m_stop = false;
+    m_seq = 0;
+    m_outbox.clear();
+    compact(snapshot);
+    m_thread = std::thread(&ReplicationServer::run, this);
+    return true;
+}
+
+void ReplicationServer::stop()
+{
+    if (!isRunning())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    char wake = 0;
+    (void)!write(m_wake_pipe[1], &wake, 1);
+    m_thread.join();
+
+    ::close(m_listen_fd);
+    ::close(m_wake_pipe[0]);
+    ::close(m_wake_pipe[1]);
+    m_listen_fd = -1;
+    m_wake_pipe[0] = m_wake_pipe[1] = -1;
+    unlink(m_socket_path.c_str());
+}
+
+void ReplicationServer::ship(std::vector<ReplicationEvent> events)
+{
+    if (events.empty())
+        return;
+    int64_t now = nowMicros();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto &event : events)
+        {
+            event.seq = ++m_seq;
+            event.timestamp_us = now;
+            size_t start = m_outbox.size();
+            appendFrame(m_outbox, event);
+            if (event.kind == ReplicationEvent::Kind::SNAPSHOT)
+            {
+                m_snapshot.assign(m_outbox, start, std::string::npos);
+                m_log.clear();
+                m_log_events = 0;
+            }
+            else
+            {
+                m_log.append(m_outbox, start, std::string::npos);
+                m_log_events++;
+            }
+        }
+    }
+    if (m_wake_pipe[1] >= 0)
+    {
+        char wake = 0;
+        (void)!write(m_wake_pipe[1], &wake, 1);
+    }
+}
+
+bool ReplicationServer::wantsSnapshot() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_log_events >= MAX_LOG_EVENTS;
+}
+
+void ReplicationServer::compact(std::string snapshot)
+{
+    ReplicationEvent frame;
+    frame.kind = ReplicationEvent::Kind::SNAPSHOT;
+    frame.timestamp_us = nowMicros();
+    frame.record = std::move(snapshot);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    frame.seq = m_seq;
+    m_snapshot.clear();
+    appendFrame(m_snapshot, frame);
+    m_log.clear();
+    m_log_events = 0;
+}
+
+uint64_t ReplicationServer::lastSeq() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_seq;
+}
+
+void ReplicationServer::run()
+{
+    std::vector<Replica> replicas;
+    auto last_heartbeat = std::chrono::steady_clock::now();
+
+    while (true)
+    {
+        std::vector<pollfd> fds = {{m_listen_fd, POLLIN, 0}, {m_wake_pipe[0], POLLIN, 0}};
+        for (const auto &replica : replicas)
+            fds.push_back({replica.fd, static_cast<short>(replica.pending.empty() ? POLLIN : POLLIN | POLLOUT), 0});
+        poll(fds.data(), fds.size(), HEARTBEAT_MS);
+
+        char drain[64];
+        while (read(m_wake_pipe[0], drain, sizeof(drain)) > 0)
+        {
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stop)
+                break;
+
+            // Existing replicas get the new events; replicas accepted now get the
+            // snapshot and the log, which already include them. Both under the
+            // lock, so each replica sees every event exactly once.
+            for (auto &replica : replicas)
+                replica.pending += m_outbox;
+            m_outbox.clear();
+
+            if (std::chrono::steady_clock::now() - last_heartbeat >= std::chrono::milliseconds(HEARTBEAT_MS))
+            {
+                ReplicationEvent heartbeat;
+                heartbeat.seq = m_seq;
+                heartbeat.timestamp_us = nowMicros();
+                std::string frame;
+                appendFrame(frame, heartbeat);
+                for (auto &replica : replicas)
+                    replica.pending += frame;
+                last_heartbeat = std::chrono::steady_clock::now();
+            }
+
+            int fd;
+            while ((fd = accept4(m_listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+                replicas.push_back({fd, m_snapshot + m_log});
+        }
+
+        for (auto &replica : replicas)
+        {
+            // Replicas never send anything; readable means they hung up.
+            char ignored[256];
+            ssize_t got = recv(replica.fd, ignored, sizeof(ignored), MSG_DONTWAIT);
+            bool alive = got != 0 && (got > 0 || errno == EAGAIN || errno == EWOULDBLOCK);
+
+            while (alive && !replica.pending.empty())
+            {
+                ssize_t sent = send(replica.fd, replica.pending.data(), replica.pending.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+                if (sent > 0)
+                    replica.pending.erase(0, static_cast<size_t>(sent));
+                else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                    break;
+                else
+                    alive = false;
+            }
+            if (!alive || replica.pending.size() > MAX_PENDING_BYTES)
+            {
+                ::close(replica.fd);
+                replica.fd = -1;
+            }
+        }
+        replicas.erase(std::remove_if(replicas.begin(), replicas.end(), [](const Replica &replica)
+                                      { return replica.fd < 0; }),
+                       replicas.end());
+        m_replica_count.store(replicas.size());
+    }
+
+    for (const auto &replica : replicas)
+        ::close(replica.fd);
+    m_replica_count.store(0);
+}
+
+#else // !__linux__
+
+ReplicationServer::~ReplicationServer() {}
+
+bool ReplicationServer::start(const std::string &, const std::string &)
+{
+    return false;
+}
+
+void ReplicationServer::stop() {}
+
+void ReplicationServer::ship(std::vector<ReplicationEvent>) {}
+
+bool ReplicationServer::wantsSnapshot() const
+{
+    return false;
+}
+
+void ReplicationServer::compact(std::string) {}
+
+uint64_t ReplicationServer::lastSeq() const
+{
+    return 0;
+}
+
+void ReplicationServer::run() {}
+
+#endif // __linux__
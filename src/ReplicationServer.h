@@ -0,0 +1,75 @@
+#ifndef REPLICATIONSERVER_H
+#define REPLICATIONSERVER_H
+
+#include "ReplicationEvent.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Primary side of the replication stream.
+// Listens on a Unix domain socket; every replica that connects is first sent a
+// snapshot of the catalog, then the events logged since that snapshot, and then
+// each event shipped after it, in order. The owner replaces the snapshot (and so
+// empties the log) when wantsSnapshot() says the log has grown long.
+// Sockets are served by a background thread, so ship() only queues and returns
+// and a slow or stuck replica never delays circulation. A replica that falls
+// too far behind is disconnected; it reconnects and starts from a new snapshot.
+// Linux only; elsewhere start() returns false.
+class ReplicationServer
+{
+public:
+    ReplicationServer() = default;
+    ~ReplicationServer(); // Stops the thread and removes the socket file.
+
+    ReplicationServer(const ReplicationServer &) = delete;
+    ReplicationServer &operator=(const ReplicationServer &) = delete;
+
+    // `snapshot` is the record of the SNAPSHOT event new replicas start from.
+    bool start(const std::string &socket_path, const std::string &snapshot);
+    void stop();
+    bool isRunning() const { return m_listen_fd >= 0; }
+
+    // Numbers and timestamps `events` (kind, copy id and record filled in by the
+    // caller), queues them for every connected replica and logs them for replicas
+    // that connect later. A SNAPSHOT event also replaces the snapshot and log.
+    void ship(std::vector<ReplicationEvent> events);
+    // True once the log holds enough events that replaying them costs more than
+    // sending a new snapshot.
+    bool wantsSnapshot() const;
+    // Replaces the snapshot new replicas start from with `snapshot` (current to
+    // the last shipped event) and empties the log. Connected replicas are not sent it.
+    void compact(std::string snapshot);
+
+    uint64_t lastSeq() const;
+    size_t replicaCount() const { return m_replica_count.load(); }
+
+private:
+    struct Replica
+    {
+        int fd;
+        std::string pending; // Encoded frames not yet accepted by the socket.
+    };
+
+    void run();
+
+    std::string m_socket_path;
+    int m_listen_fd = -1;
+    int m_wake_pipe[2] = {-1, -1}; // ship() and stop() write a byte here to wake the thread.
+
+    mutable std::mutex m_mutex;
+    uint64_t m_seq = 0;
+    std::string m_outbox;   // Frames shipped since the thread last ran.
+    std::string m_snapshot; // Encoded snapshot frame.
+    std::string m_log;      // Encoded frames shipped since m_snapshot.
+    size_t m_log_events = 0;
+    bool m_stop = false;
+
+    std::atomic<size_t> m_replica_count{0};
+    std::thread m_thread;
+};
+
+#endif // REPLICATIONSERVER_H
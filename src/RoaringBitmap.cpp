@@ -0,0 +1,280 @@
+#include "RoaringBitmap.h"
+
+#include <algorithm>
+#include <bitset>
+#include <iterator>
+
+namespace
+{
+    uint32_t popcount(uint64_t word)
+    {
+        return static_cast<uint32_t>(std::bitset<64>(word).count());
+    }
+}
+
+RoaringBitmap::Container *RoaringBitmap::find(uint16_t key)
+{
+    auto it = std::lower_bound(m_containers.begin(), m_containers.end(), key, [](const Container &container, uint16_t k)
+                               { return container.key < k; });
+    return (it != m_containers.end() && it->key == key) ? &*it : nullptr;
+}
+
+const RoaringBitmap::Container *RoaringBitmap::find(uint16_t key) const
+{
+    return const_cast<RoaringBitmap *>(this)->find(key);
+}
+
+void RoaringBitmap::add(uint32_t id)
+{
+    uint16_t key = static_cast<uint16_t>(id >> 16);
+    uint16_t low = static_cast<uint16_t>(id & 0xFFFF);
+    auto it = std::lower_bound(m_containers.begin(), m_containers.end(), key, [](const Container &container, uint16_t k)
+                               { return container.key < k; });
+    if (it == m_containers.end() || it->key != key)
+    {
+        it = m_containers.insert(it, Container());
+        it->key = key;
+    }
+
+    Container &container = *it;
+    if (container.isBitmap())
+    {
+        uint64_t &word = container.words[low / 64];
+        uint64_t bit = uint64_t(1) << (low % 64);
+        if ((word & bit) == 0)
+        {
+            word |= bit;
+            container.cardinality++;
+        }
+        return;
+    }
+    auto position = std::lower_bound(container.array.begin(), container.array.end(), low);
+    if (position != container.array.end() && *position == low)
+        return;
+    container.array.insert(position, low);
+    container.cardinality++;
+    if (container.cardinality > ARRAY_LIMIT)
+        toBitmap(container);
+}
+
+void RoaringBitmap::remove(uint32_t id)
+{
+    uint16_t key = static_cast<uint16_t>(id >> 16);
+    uint16_t low = static_cast<uint16_t>(id & 0xFFFF);
+    Container *container = find(key);
+    if (container == nullptr)
+        return;
+
+    if (container->isBitmap())
+    {
+        uint64_t &word = container->words[low / 64];
+        uint64_t bit = uint64_t(1) << (low % 64);
+        if ((word & bit) == 0)
+            return;
+        word &= ~bit;
+        container->cardinality--;
+        if (container->cardinality <= ARRAY_LIMIT)
+            toArray(*container);
+    }
+    else
+    {
+        auto position = std::lower_bound(container->array.begin(), container->array.end(), low);
+        if (position == container->array.end() || *position != low)
+            return;
+        container->array.erase(position);
+        container->cardinality--;
+    }
+    if (container->cardinality == 0)
+        m_containers.erase(m_containers.begin() + (container - m_containers.data()));
+}
+
+bool RoaringBitmap::contains(uint32_t id) const
+{
+    const Container *container = find(static_cast<uint16_t>(id >> 16));
+    if (container == nullptr)
+        return false;
+    uint16_t low = static_cast<uint16_t>(id & 0xFFFF);
+    if (container->isBitmap())
+        return (container->words[low / 64] >> (low % 64)) & 1;
+    return std::binary_search(container->array.begin(), container->array.end(), low);
+}
+
+size_t RoaringBitmap::cardinality() const
+{
+    size_t total = 0;
+    for (const auto &container : m_containers)
+        total += container.cardinality;
+    return total;
+}
+
+size_t RoaringBitmap::memoryBytes() const
+{
+    size_t bytes = m_containers.capacity() * sizeof(Container);
+    for (const auto &container : m_containers)
+        bytes += container.array.capacity() * sizeof(uint16_t) + container.words.capacity() * sizeof(uint64_t);
+    return bytes;
+}
+
+void RoaringBitmap::appendTo(std::vector<uint32_t> &ids) const
+{
+    ids.reserve(ids.size() + cardinality());
+    for (const auto &container : m_containers)
+    {
+        uint32_t high = uint32_t(container.key) << 16;
+        if (!container.isBitmap())
+        {
+            for (uint16_t low : container.array)
+                ids.push_back(high | low);
+            continue;
+        }
+        for (size_t i = 0; i < BITMAP_WORDS; ++i)
+        {
+            uint64_t word = container.words[i];
+            while (word != 0)
+            {
+                uint64_t lowest = word & (~word + 1);
+                ids.push_back(high | static_cast<uint32_t>(i * 64 + popcount(lowest - 1)));
+                word ^= lowest;
+            }
+        }
+    }
+}
+
+void RoaringBitmap::toBitmap(Container &container)
+{
+    container.words.assign(BITMAP_WORDS, 0);
+    for (uint16_t low : container.array)
+        container.words[low / 64] |= uint64_t(1) << (low % 64);
+    std::vector<uint16_t>().swap(container.array);
+}
+
+void RoaringBitmap::toArray(Container &container)
+{
+    std::vector<uint16_t> array;
+    array.reserve(container.cardinality);
+    for (size_t i = 0; i < BITMAP_WORDS; ++i)
+    {
+        uint64_t word = container.words[i];
+        while (word != 0)
+        {
+            uint64_t lowest = word & (~word + 1);
+            array.push_back(static_cast<uint16_t>(i * 64 + popcount(lowest - 1)));
+            word ^= lowest;
+        }
+    }
+    container.array.swap(array);
+    std::vector<uint64_t>().swap(container.words);
+}
+
+RoaringBitmap::Container RoaringBitmap::intersect(const Container &a, const Container &b)
+{
+    Container result;
+    result.key = a.key;
+    if (a.isBitmap() && b.isBitmap())
+    {
+        result.words.resize(BITMAP_WORDS);
+        const uint64_t *x = a.words.data();
+        const uint64_t *y = b.words.data();
+        uint64_t *out = result.words.data();
+        for (size_t i = 0; i < BITMAP_WORDS; ++i)
+            out[i] = x[i] & y[i];
+        uint32_t count = 0;
+        for (size_t i = 0; i < BITMAP_WORDS; ++i)
+            count += popcount(out[i]);
+        result.cardinality = count;
+        if (count <= ARRAY_LIMIT)
+            toArray(result);
+    }
+    else if (!a.isBitmap() && !b.isBitmap())
+    {
+        std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(result.array));
+        result.cardinality = static_cast<uint32_t>(result.array.size());
+    }
+    else
+    {
+        const Container &sparse = a.isBitmap() ? b : a;
+        const Container &dense = a.isBitmap() ? a : b;
+        for (uint16_t low : sparse.array)
+        {
+            if ((dense.words[low / 64] >> (low % 64)) & 1)
+                result.array.push_back(low);
+        }
+        result.cardinality = static_cast<uint32_t>(result.array.size());
+    }
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::unite(const Container &a, const Container &b)
+{
+    Container result;
+    result.key = a.key;
+    if (!a.isBitmap() && !b.isBitmap() && a.cardinality + b.cardinality <= ARRAY_LIMIT)
+    {
+        std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(result.array));
+        result.cardinality = static_cast<uint32_t>(result.array.size());
+        return result;
+    }
+
+    // Work in bitmap form; arrays are scattered into it.
+    result.words.assign(BITMAP_WORDS, 0);
+    uint64_t *out = result.words.data();
+    for (const Container *side : {&a, &b})
+    {
+        if (side->isBitmap())
+        {
+            const uint64_t *x = side->words.data();
+            for (size_t i = 0; i < BITMAP_WORDS; ++i)
+                out[i] |= x[i];
+        }
+        else
+        {
+            for (uint16_t low : side->array)
+                out[low / 64] |= uint64_t(1) << (low % 64);
+        }
+    }
+    uint32_t count = 0;
+    for (size_t i = 0; i < BITMAP_WORDS; ++i)
+        count += popcount(out[i]);
+    result.cardinality = count;
+    if (count <= ARRAY_LIMIT)
+        toArray(result);
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::intersect(const RoaringBitmap &a, const RoaringBitmap &b)
+{
+    RoaringBitmap result;
+    auto x = a.m_containers.begin(), y = b.m_containers.begin();
+    while (x != a.m_containers.end() && y != b.m_containers.end())
+    {
+        if (x->key < y->key)
+            ++x;
+        else if (y->key < x->key)
+            ++y;
+        else
+        {
+            Container both = intersect(*x, *y);
+            if (both.cardinality > 0)
+                result.m_containers.push_back(std::move(both));
+            ++x;
+            ++y;
+        }
+    }
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::unite(const RoaringBitmap &a, const RoaringBitmap &b)
+{
+    RoaringBitmap result;
+    auto x = a.m_containers.begin(), y = b.m_containers.begin();
+    while (x != a.m_containers.end() || y != b.m_containers.end())
+    {
+        if (y == b.m_containers.end() || (x != a.m_containers.end() && x->key < y->key))
+            result.m_containers.push_back(*x++);
+        else if (x == a.m_containers.end() || y->key < x->key)
+            result.m_containers.push_back(*y++);
+        else
+            result.m_containers.push_back(unite(*x++, *y++));
+    }
+    return result;
+}
@@ -0,0 +1,57 @@
+#ifndef ROARINGBITMAP_H
+#define ROARINGBITMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compressed set of 32-bit ids, laid out like a Roaring bitmap.
+// Ids are grouped by their high 16 bits; each group is a container holding the
+// low 16 bits either as a sorted array (sparse groups, up to ARRAY_LIMIT ids)
+// or as a 65536-bit bitmap (dense groups). Bitmap containers are combined a
+// 64-bit word at a time in plain loops the compiler vectorizes, so AND/OR over
+// dense facets costs 1024 word operations per 65536 ids.
+class RoaringBitmap
+{
+public:
+    static const size_t ARRAY_LIMIT = 4096; // Beyond this a bitmap (8 KiB) is smaller than an array.
+
+    void add(uint32_t id);
+    void remove(uint32_t id);
+    bool contains(uint32_t id) const;
+    void clear() { m_containers.clear(); }
+
+    size_t cardinality() const;
+    bool empty() const { return m_containers.empty(); }
+    size_t memoryBytes() const;
+
+    // Appends every id in ascending order.
+    void appendTo(std::vector<uint32_t> &ids) const;
+
+    static RoaringBitmap intersect(const RoaringBitmap &a, const RoaringBitmap &b);
+    static RoaringBitmap unite(const RoaringBitmap &a, const RoaringBitmap &b);
+
+private:
+    static const size_t BITMAP_WORDS = 65536 / 64;
+
+    struct Container
+    {
+        uint16_t key = 0;          // High 16 bits shared by every id in the container.
+        uint32_t cardinality = 0;
+        std::vector<uint16_t> array; // Sorted low bits, while the container is sparse.
+        std::vector<uint64_t> words; // BITMAP_WORDS words once it is dense; array is then empty.
+
+        bool isBitmap() const { return !words.empty(); }
+    };
+
+    Container *find(uint16_t key);
+    const Container *find(uint16_t key) const;
+    static void toBitmap(Container &container);
+    static void toArray(Container &container);
+    static Container intersect(const Container &a, const Container &b);
+    static Container unite(const Container &a, const Container &b);
+
+    std::vector<Container> m_containers; // Sorted by key.
+};
+
+#endif // ROARINGBITMAP_H
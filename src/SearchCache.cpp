@@ -0,0 +1,104 @@
+#include "SearchCache.h"
+
+#include <cctype>
+#include <iterator>
+
+SearchCache::SearchCache(size_t budget_bytes)
+    : m_budget_bytes(budget_bytes)
+{
+}
+
+std::string SearchCache::normalize(const std::string &query)
+{
+    std::string normalized;
+    bool pending_space = false;
+    for (unsigned char c : query)
+    {
+        if (std::isspace(c))
+        {
+            pending_space = !normalized.empty();
+            continue;
+        }
+        if (pending_space)
+            normalized += ' ';
+        pending_space = false;
+        normalized += static_cast<char>(std::tolower(c));
+    }
+    return normalized;
+}
+
+SearchCache::Ids SearchCache::lookup(const std::string &key, uint64_t generation)
+{
+    auto it = m_lookup.find(key);
+    if (it == m_lookup.end())
+    {
+        m_stats.misses++;
+        return nullptr;
+    }
+    if (it->second->generation != generation)
+    {
+        erase(it->second);
+        m_stats.misses++;
+        m_stats.stale++;
+        return nullptr;
+    }
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    m_stats.hits++;
+    return it->second->ids;
+}
+
+SearchCache::Ids SearchCache::store(const std::string &key, uint64_t generation, std::vector<uint32_t> ids)
+{
+    auto it = m_lookup.find(key);
+    if (it != m_lookup.end())
+        erase(it->second);
+
+    Ids shared = std::make_shared<const std::vector<uint32_t>>(std::move(ids));
+    Entry entry{key, generation, shared};
+    size_t bytes = entryBytes(entry);
+    if (bytes > m_budget_bytes)
+        return shared; // Would evict everything else and still not fit.
+
+    m_entries.push_front(std::move(entry));
+    m_lookup[key] = m_entries.begin();
+    m_bytes += bytes;
+    evictToBudget();
+    return shared;
+}
+
+void SearchCache::setBudget(size_t budget_bytes)
+{
+    m_budget_bytes = budget_bytes;
+    evictToBudget();
+}
+
+SearchCache::Stats SearchCache::stats() const
+{
+    Stats stats = m_stats;
+    stats.entries = m_entries.size();
+    stats.bytes = m_bytes;
+    stats.budget_bytes = m_budget_bytes;
+    return stats;
+}
+
+// Rough heap footprint: the key and ID storage plus list/map node overhead.
+size_t SearchCache::entryBytes(const Entry &entry)
+{
+    return sizeof(Entry) + 2 * entry.key.capacity() + entry.ids->capacity() * sizeof(uint32_t) + 64;
+}
+
+void SearchCache::evictToBudget()
+{
+    while (m_bytes > m_budget_bytes && !m_entries.empty())
+    {
+        erase(std::prev(m_entries.end()));
+        m_stats.evictions++;
+    }
+}
+
+void SearchCache::erase(std::list<Entry>::iterator entry)
+{
+    m_bytes -= entryBytes(*entry);
+    m_lookup.erase(entry->key);
+    m_entries.erase(entry);
+}
@@ -0,0 +1,66 @@
+#ifndef SEARCHCACHE_H
+#define SEARCHCACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// LRU cache of search results: normalized query -> list of record IDs.
+// Lists are shared and immutable, so a hit hands out the cached list itself
+// rather than a copy, and a list being paged through survives eviction.
+// Each entry remembers the catalog generation it was computed at; a lookup with
+// a newer generation treats the entry as stale, so invalidating the whole cache
+// is just a counter bump in the caller. Entries are evicted least recently used
+// first once their estimated size exceeds the memory budget.
+class SearchCache
+{
+public:
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t stale = 0; // Misses caused by a generation change.
+        uint64_t evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+        size_t budget_bytes = 0;
+    };
+
+    explicit SearchCache(size_t budget_bytes = 4 * 1024 * 1024);
+
+    // Lowercases, trims and collapses whitespace so equivalent queries share an entry.
+    static std::string normalize(const std::string &query);
+
+    using Ids = std::shared_ptr<const std::vector<uint32_t>>;
+
+    // Returns nullptr on a miss.
+    Ids lookup(const std::string &key, uint64_t generation);
+    // Returns the stored list (also when it was too large to keep).
+    Ids store(const std::string &key, uint64_t generation, std::vector<uint32_t> ids);
+    void setBudget(size_t budget_bytes);
+
+    Stats stats() const;
+
+private:
+    struct Entry
+    {
+        std::string key;
+        uint64_t generation;
+        Ids ids;
+    };
+
+    static size_t entryBytes(const Entry &entry);
+    void evictToBudget();
+    void erase(std::list<Entry>::iterator entry);
+
+    size_t m_budget_bytes;
+    size_t m_bytes = 0;
+    std::list<Entry> m_entries; // Front = most recently used.
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_lookup;
+    Stats m_stats;
+};
+
+#endif // SEARCHCACHE_H
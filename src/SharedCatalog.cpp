@@ -0,0 +1,650 @@
+#include "SharedCatalog.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    // Same field widths as the page store, so a book that fits one fits the other.
+    struct Record
+    {
+        char isbn[24];
+        char title[128];
+        char author[80];
+        char borrower[32];
+        int32_t copy_id;
+        uint8_t checked_out;
+        uint8_t in_use; // The slot holds a book.
+        uint8_t reserved[2];
+        int64_t due_date;
+    };
+
+    template <size_t N>
+    void writeField(char (&field)[N], const std::string &value)
+    {
+        std::memset(field, 0, N);
+        std::memcpy(field, value.data(), std::min(value.size(), N));
+    }
+
+    template <size_t N>
+    std::string readField(const char (&field)[N])
+    {
+        return std::string(field, strnlen(field, N));
+    }
+
+    void readRecord(const Record &record, Book &book)
+    {
+        book.isbn = readField(record.isbn);
+        book.title = readField(record.title);
+        book.author = readField(record.author);
+        book.borrowerUsername = readField(record.borrower);
+        book.copyId = record.copy_id;
+        book.isCheckedOut = record.checked_out != 0;
+        book.dueDate = static_cast<std::time_t>(record.due_date);
+    }
+
+    void writeRecord(Record &record, const Book &book)
+    {
+        writeField(record.isbn, book.isbn);
+        writeField(record.title, book.title);
+        writeField(record.author, book.author);
+        writeField(record.borrower, book.borrowerUsername);
+        record.copy_id = book.copyId;
+        record.checked_out = book.isCheckedOut ? 1 : 0;
+        record.in_use = 1;
+        std::memset(record.reserved, 0, sizeof(record.reserved));
+        record.due_date = static_cast<int64_t>(book.dueDate);
+    }
+
+    bool sameRecord(const Book &a, const Book &b)
+    {
+        return a.isbn == b.isbn && a.copyId == b.copyId && a.title == b.title && a.author == b.author &&
+               a.isCheckedOut == b.isCheckedOut && a.borrowerUsername == b.borrowerUsername && a.dueDate == b.dueDate;
+    }
+}
+
+bool SharedCatalog::fits(const Book &book)
+{
+    const Record *record = nullptr;
+    return !book.isbn.empty() && book.isbn.size() <= sizeof(record->isbn) &&
+           book.title.size() <= sizeof(record->title) &&
+           book.author.size() <= sizeof(record->author) &&
+           book.borrowerUsername.size() <= sizeof(record->borrower);
+}
+
+// --- Key Index ---
+
+void SharedCatalog::remember(uint32_t slot, const Key &key)
+{
+    Key &current = m_key_of[slot];
+    if (!current.first.empty())
+        m_slot_of.erase(current);
+    current = key;
+    if (!key.first.empty())
+        m_slot_of[key] = slot;
+}
+
+bool SharedCatalog::findSlot(const Key &key, uint32_t &slot) const
+{
+    auto it = m_slot_of.find(key);
+    if (it == m_slot_of.end())
+        return false;
+    slot = it->second;
+    return true;
+}
+
+#ifdef __linux__
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    const char MAGIC[8] = {'L', 'I', 'B', 'S', 'H', 'M', '0', '3'};
+    const uint64_t LOG_CAPACITY = 1024;
+    // Failed optimistic reads before a reader waits on the writer lock instead.
+    const int READ_ATTEMPTS = 1000;
+
+    struct LogEntry
+    {
+        uint64_t generation; // The change this entry is for; a stale slot in the ring has another.
+        uint32_t slot;
+        uint32_t text_changed;
+    };
+
+    // What the write in progress is about to change, so it can be put back.
+    struct Undo
+    {
+        uint32_t active;
+        uint32_t slot;
+        uint64_t high_water;
+        uint64_t free_top;
+        uint64_t generation;
+        Record record;
+    };
+
+    struct Header
+    {
+        char magic[8];
+        std::atomic<uint32_t> ready; // Set by the creator once the lock is initialised and the seed written.
+        uint32_t record_size;
+        uint64_t capacity;
+        std::atomic<uint64_t> sequence;   // Odd while a write is in progress.
+        std::atomic<uint64_t> generation; // Writes so far; write g is logged at log[g % LOG_CAPACITY].
+        uint64_t high_water;              // Slots [0, high_water) have been handed out at least once.
+        uint64_t free_top;                // Entries on the free-slot stack.
+        Undo undo;
+        LogEntry log[LOG_CAPACITY];
+        pthread_mutex_t lock; // Writers only.
+    };
+
+    // Records start on the first cache line after the header; the free-slot stack follows them.
+    const size_t RECORDS_OFFSET = (sizeof(Header) + 63) / 64 * 64;
+
+    size_t segmentBytes(size_t capacity)
+    {
+        return RECORDS_OFFSET + capacity * (sizeof(Record) + sizeof(uint32_t));
+    }
+
+    Header *headerOf(void *base)
+    {
+        return static_cast<Header *>(base);
+    }
+
+    Record *recordsOf(void *base)
+    {
+        return reinterpret_cast<Record *>(static_cast<char *>(base) + RECORDS_OFFSET);
+    }
+
+    uint32_t *freeSlotsOf(void *base)
+    {
+        return reinterpret_cast<uint32_t *>(recordsOf(base) + headerOf(base)->capacity);
+    }
+
+    // Puts back whatever a dead writer had half changed. A write is only
+    // complete once the sequence is even again; if the writer died before
+    // that, the slot, the free-slot stack and the generation are restored.
+    void rollBack(void *base)
+    {
+        Header *header = headerOf(base);
+        uint64_t sequence = header->sequence.load(std::memory_order_relaxed);
+        if ((sequence & 1) == 0)
+        {
+            header->undo.active = 0;
+            return;
+        }
+        if (header->undo.active != 0)
+        {
+            recordsOf(base)[header->undo.slot] = header->undo.record;
+            header->high_water = header->undo.high_water;
+            header->free_top = header->undo.free_top;
+            header->generation.store(header->undo.generation, std::memory_order_relaxed);
+            header->undo.active = 0;
+        }
+        header->sequence.store(sequence + 1, std::memory_order_release);
+    }
+
+    bool lockCatalog(void *base)
+    {
+        Header *header = headerOf(base);
+        int result = pthread_mutex_lock(&header->lock);
+        if (result == EOWNERDEAD)
+        {
+            rollBack(base);
+            result = pthread_mutex_consistent(&header->lock);
+        }
+        return result == 0;
+    }
+
+    // Runs `copy` until it ran with no write in progress. A reader that keeps
+    // losing the race, or finds a write that never finishes (its writer died),
+    // takes the writer lock for one last copy; taking it rolls back a dead writer.
+    template <typename Copy>
+    bool readConsistent(void *base, Copy copy)
+    {
+        Header *header = headerOf(base);
+        for (int attempt = 0; attempt < READ_ATTEMPTS; ++attempt)
+        {
+            uint64_t sequence = header->sequence.load(std::memory_order_acquire);
+            if ((sequence & 1) == 0)
+            {
+                copy();
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (header->sequence.load(std::memory_order_relaxed) == sequence)
+                    return true;
+            }
+            std::this_thread::yield();
+        }
+        if (!lockCatalog(base))
+            return false;
+        copy();
+        pthread_mutex_unlock(&header->lock);
+        return true;
+    }
+
+    // Opens write `slot` on the undo area and the sequence; the caller then changes it.
+    void beginWrite(void *base, uint32_t slot)
+    {
+        Header *header = headerOf(base);
+        Undo &undo = header->undo;
+        undo.slot = slot;
+        undo.high_water = header->high_water;
+        undo.free_top = header->free_top;
+        undo.generation = header->generation.load(std::memory_order_relaxed);
+        undo.record = recordsOf(base)[slot];
+        undo.active = 1;
+        header->sequence.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    // Logs the write and closes it; returns its generation.
+    uint64_t endWrite(void *base, uint32_t slot, bool text_changed)
+    {
+        Header *header = headerOf(base);
+        uint64_t generation = header->generation.load(std::memory_order_relaxed) + 1;
+        header->log[generation % LOG_CAPACITY] = LogEntry{generation, slot, text_changed ? 1u : 0u};
+        header->generation.store(generation, std::memory_order_release);
+        header->sequence.fetch_add(1, std::memory_order_release);
+        header->undo.active = 0;
+        return generation;
+    }
+}
+
+SharedCatalog::~SharedCatalog()
+{
+    close();
+}
+
+bool SharedCatalog::map(int fd, bool created)
+{
+    // Another process can get here while the creator is still sizing the segment.
+    struct stat info;
+    for (int attempt = 0; attempt < 100 && !created; ++attempt)
+    {
+        if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= RECORDS_OFFSET)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < RECORDS_OFFSET)
+        return false;
+    void *base = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED)
+        return false;
+    m_base = base;
+    m_mapped_bytes = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+bool SharedCatalog::attach(const std::string &name)
+{
+    close();
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+        return false;
+    bool mapped = map(fd, false);
+    ::close(fd);
+    if (!mapped)
+        return false;
+
+    Header *header = headerOf(m_base);
+    for (int attempt = 0; attempt < 100 && header->ready.load(std::memory_order_acquire) == 0; ++attempt)
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    if (header->ready.load(std::memory_order_acquire) == 0 || std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header->record_size != sizeof(Record) || segmentBytes(header->capacity) > m_mapped_bytes)
+    {
+        close();
+        return false;
+    }
+    m_key_of.assign(header->capacity, Key());
+    return true;
+}
+
+bool SharedCatalog::create(const std::string &name, size_t capacity, const std::vector<Book> &seed, bool &exists)
+{
+    close();
+    exists = false;
+    if (seed.size() > capacity || !std::all_of(seed.begin(), seed.end(), fits))
+        return false;
+
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0660);
+    if (fd < 0)
+    {
+        exists = errno == EEXIST;
+        return false;
+    }
+    bool mapped = ftruncate(fd, static_cast<off_t>(segmentBytes(capacity))) == 0 && map(fd, true);
+    ::close(fd);
+    if (!mapped)
+    {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    Header *header = headerOf(m_base);
+    std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+    header->record_size = sizeof(Record);
+    header->capacity = capacity;
+    header->sequence.store(0);
+    header->generation.store(0);
+    header->high_water = seed.size();
+    header->free_top = 0;
+    header->undo.active = 0;
+    Record *records = recordsOf(m_base);
+    for (size_t i = 0; i < seed.size(); ++i)
+        writeRecord(records[i], seed[i]);
+
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&header->lock, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+
+    m_key_of.assign(capacity, Key());
+    indexSlots();
+    header->ready.store(1, std::memory_order_release);
+    return true;
+}
+
+void SharedCatalog::close()
+{
+    if (m_base != nullptr)
+        munmap(m_base, m_mapped_bytes);
+    m_base = nullptr;
+    m_mapped_bytes = 0;
+    m_slot_of.clear();
+    m_key_of.clear();
+    m_generation = 0;
+    m_overflowed = false;
+}
+
+size_t SharedCatalog::capacity() const
+{
+    return isOpen() ? headerOf(m_base)->capacity : 0;
+}
+
+uint64_t SharedCatalog::generation() const
+{
+    return isOpen() ? headerOf(m_base)->generation.load(std::memory_order_acquire) : 0;
+}
+
+bool SharedCatalog::find(const std::string &isbn, int32_t copy_id, Book &out) const
+{
+    uint32_t slot = 0;
+    if (!isOpen() || !findSlot(Key(isbn, copy_id), slot))
+        return false;
+    Record record;
+    if (!readConsistent(m_base, [&]()
+                        { record = recordsOf(m_base)[slot]; }))
+        return false;
+    // The slot may have been freed or reused since this process last caught up.
+    if (record.in_use == 0 || record.copy_id != copy_id || readField(record.isbn) != isbn)
+        return false;
+    readRecord(record, out);
+    return true;
+}
+
+bool SharedCatalog::read(std::vector<Book> &books)
+{
+    books.clear();
+    if (!isOpen())
+        return false;
+    Header *header = headerOf(m_base);
+    std::vector<Record> records;
+    uint64_t generation = 0;
+    if (!readConsistent(m_base, [&]()
+                        {
+                            generation = header->generation.load(std::memory_order_relaxed);
+                            const Record *slots = recordsOf(m_base);
+                            records.assign(slots, slots + header->high_water);
+                        }))
+        return false;
+
+    m_slot_of.clear();
+    m_key_of.assign(header->capacity, Key());
+    Book book;
+    for (size_t slot = 0; slot < records.size(); ++slot)
+    {
+        if (records[slot].in_use == 0)
+            continue;
+        readRecord(records[slot], book);
+        remember(static_cast<uint32_t>(slot), Key(book.isbn, book.copyId));
+        books.push_back(book);
+    }
+    m_generation = generation;
+    m_overflowed = false;
+    return true;
+}
+
+bool SharedCatalog::catchUp(std::vector<Change> &changes)
+{
+    Header *header = headerOf(m_base);
+    uint64_t generation = 0;
+    bool overflowed = false;
+    std::vector<LogEntry> entries;
+    std::vector<std::pair<uint32_t, Record>> slots; // Each changed slot once, as it is now.
+    if (!readConsistent(m_base, [&]()
+                        {
+                            entries.clear();
+                            slots.clear();
+                            generation = header->generation.load(std::memory_order_relaxed);
+                            overflowed = generation - m_generation > LOG_CAPACITY;
+                            for (uint64_t g = m_generation + 1; !overflowed && g <= generation; ++g)
+                            {
+                                const LogEntry &entry = header->log[g % LOG_CAPACITY];
+                                overflowed = entry.generation != g || entry.slot >= header->capacity;
+                                entries.push_back(entry);
+                            }
+                            for (const auto &entry : entries)
+                            {
+                                if (std::none_of(slots.begin(), slots.end(), [&](const std::pair<uint32_t, Record> &seen)
+                                                 { return seen.first == entry.slot; }))
+                                    slots.emplace_back(entry.slot, recordsOf(m_base)[entry.slot]);
+                            }
+                        }))
+        return false;
+    if (overflowed)
+        return false;
+
+    // Removals first, so a key that moved to another slot is gone before it reappears.
+    std::vector<Change> present;
+    for (const auto &changed : slots)
+    {
+        const uint32_t slot = changed.first;
+        Change change;
+        Key now;
+        if (changed.second.in_use != 0)
+        {
+            readRecord(changed.second, change.book);
+            now = Key(change.book.isbn, change.book.copyId);
+        }
+        const Key &before = m_key_of[slot];
+        if (!before.first.empty() && before != now)
+        {
+            Change removal;
+            removal.book.isbn = before.first;
+            removal.book.copyId = before.second;
+            removal.present = false;
+            changes.push_back(std::move(removal));
+        }
+        if (now.first.empty())
+        {
+            remember(slot, now);
+            continue;
+        }
+        change.text_changed = before != now || std::any_of(entries.begin(), entries.end(), [slot](const LogEntry &entry)
+                                                           { return entry.slot == slot && entry.text_changed != 0; });
+        remember(slot, now);
+        present.push_back(std::move(change));
+    }
+    for (auto &change : present)
+        changes.push_back(std::move(change));
+    m_generation = generation;
+    return true;
+}
+
+bool SharedCatalog::changes(std::vector<Change> &changes)
+{
+    if (!isOpen() || m_overflowed)
+        return false;
+    if (generation() == m_generation)
+        return true;
+    return catchUp(changes);
+}
+
+void SharedCatalog::indexSlots()
+{
+    Header *header = headerOf(m_base);
+    m_slot_of.clear();
+    m_key_of.assign(header->capacity, Key());
+    const Record *records = recordsOf(m_base);
+    for (uint64_t slot = 0; slot < header->high_water; ++slot)
+    {
+        if (records[slot].in_use != 0)
+            remember(static_cast<uint32_t>(slot), Key(readField(records[slot].isbn), records[slot].copy_id));
+    }
+    m_generation = header->generation.load(std::memory_order_relaxed);
+}
+
+SharedCatalog::Result SharedCatalog::apply(std::vector<Edit> &edits, std::vector<Change> &earlier)
+{
+    if (!isOpen())
+        return Result::FAILED;
+    Header *header = headerOf(m_base);
+    if (!lockCatalog(m_base))
+        return Result::FAILED;
+    auto unlock = [header](Result result)
+    {
+        pthread_mutex_unlock(&header->lock);
+        return result;
+    };
+
+    // With the lock held nothing changes under us, so catching up cannot race a writer.
+    if (!catchUp(earlier))
+    {
+        indexSlots();
+        m_overflowed = true; // What was skipped is only available as a full read().
+    }
+
+    // Check everything before changing anything.
+    Record *records = recordsOf(m_base);
+    std::vector<uint32_t> slots(edits.size(), 0);
+    size_t inserts = 0;
+    for (size_t i = 0; i < edits.size(); ++i)
+    {
+        const Edit &edit = edits[i];
+        if (edit.kind == Edit::Kind::INSERT)
+        {
+            if (!fits(edit.after))
+                return unlock(Result::FAILED);
+            inserts++;
+            continue;
+        }
+        if (edit.kind == Edit::Kind::REPLACE &&
+            (!fits(edit.after) || edit.after.isbn != edit.before.isbn || edit.after.copyId != edit.before.copyId))
+            return unlock(Result::FAILED);
+        Book stored;
+        if (!findSlot(Key(edit.before.isbn, edit.before.copyId), slots[i]))
+            return unlock(Result::CONFLICT);
+        readRecord(records[slots[i]], stored);
+        if (!sameRecord(stored, edit.before))
+            return unlock(Result::CONFLICT);
+    }
+    if (inserts > header->free_top + (header->capacity - header->high_water))
+        return unlock(Result::FULL);
+
+    uint32_t *free_slots = freeSlotsOf(m_base);
+    for (size_t i = 0; i < edits.size(); ++i)
+    {
+        Edit &edit = edits[i];
+        uint32_t slot = slots[i];
+        bool text_changed = true;
+        if (edit.kind == Edit::Kind::INSERT)
+        {
+            // The next copy id of the ISBN; the key index is up to date under the lock.
+            auto last = m_slot_of.lower_bound(Key(edit.after.isbn + '\0', INT32_MIN));
+            edit.after.copyId = (last != m_slot_of.begin() && std::prev(last)->first.first == edit.after.isbn)
+                                    ? std::prev(last)->first.second + 1
+                                    : 0;
+            slot = header->free_top > 0 ? free_slots[header->free_top - 1] : static_cast<uint32_t>(header->high_water);
+            beginWrite(m_base, slot);
+            if (header->free_top > 0)
+                header->free_top--;
+            else
+                header->high_water++;
+            writeRecord(records[slot], edit.after);
+            remember(slot, Key(edit.after.isbn, edit.after.copyId));
+        }
+        else if (edit.kind == Edit::Kind::REPLACE)
+        {
+            text_changed = edit.after.title != edit.before.title || edit.after.author != edit.before.author;
+            beginWrite(m_base, slot);
+            writeRecord(records[slot], edit.after);
+        }
+        else
+        {
+            beginWrite(m_base, slot);
+            std::memset(&records[slot], 0, sizeof(Record));
+            free_slots[header->free_top++] = slot;
+            remember(slot, Key());
+        }
+        m_generation = endWrite(m_base, slot, text_changed);
+    }
+    return unlock(Result::OK);
+}
+
+#else // !__linux__
+
+SharedCatalog::~SharedCatalog() {}
+
+bool SharedCatalog::attach(const std::string &)
+{
+    return false;
+}
+
+bool SharedCatalog::create(const std::string &, size_t, const std::vector<Book> &, bool &exists)
+{
+    exists = false;
+    return false;
+}
+
+void SharedCatalog::close() {}
+
+size_t SharedCatalog::capacity() const
+{
+    return 0;
+}
+
+uint64_t SharedCatalog::generation() const
+{
+    return 0;
+}
+
+bool SharedCatalog::find(const std::string &, int32_t, Book &) const
+{
+    return false;
+}
+
+bool SharedCatalog::read(std::vector<Book> &books)
+{
+    books.clear();
+    return false;
+}
+
+bool SharedCatalog::changes(std::vector<Change> &)
+{
+    return false;
+}
+
+SharedCatalog::Result SharedCatalog::apply(std::vector<Edit> &, std::vector<Change> &)
+{
+    return Result::FAILED;
+}
+
+#endif // __linux__
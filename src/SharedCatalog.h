@@ -0,0 +1,129 @@
+#ifndef SHAREDCATALOG_H
+#define SHAREDCATALOG_H
+
+#include "Book.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The book catalog in a POSIX shared-memory segment, shared by every
+// MyLibraryApp process on the host that opens the same name. It is the only
+// copy of the records: processes keep just their keys and read the records
+// from the segment as they need them.
+// The segment is a header followed by a fixed-capacity array of fixed-size
+// record slots and a stack of free slots; it holds no pointers, so each
+// process can map it at any address. A record stays in its slot for life.
+// Readers never lock. Writers take a process-shared robust mutex, and each
+// record write is bracketed by a sequence counter (a seqlock) that readers
+// check to retry a read that overlapped it. Before a write touches anything it
+// saves what it will change in an undo area, so if a writer dies part way the
+// next process to take the mutex (EOWNERDEAD) rolls the write back; a reader
+// that finds a write stuck does the same.
+// Every write is also appended to a change log (a ring in the header) under
+// the generation it produced, so a process catches up by reading only the
+// records that changed since it last looked.
+// Linux only; elsewhere attach() and create() return false.
+class SharedCatalog
+{
+public:
+    // One record change, checked and applied under the writer lock. `before` is
+    // the record as the caller last read it (unused for an insert), `after`
+    // what it becomes (unused for an erase). An insert gets the next free copy
+    // id of its ISBN, written back into `after`.
+    struct Edit
+    {
+        enum class Kind
+        {
+            INSERT,
+            REPLACE,
+            ERASE
+        };
+        Kind kind;
+        Book before;
+        Book after;
+    };
+    enum class Result
+    {
+        OK,
+        CONFLICT, // Another process changed or removed a record since `before` was read.
+        FULL,
+        FAILED    // A book does not fit, a REPLACE changes the key, or the segment could not be locked.
+    };
+
+    // A record another process inserted, changed or removed (`present` false;
+    // then only the key in `book` is set).
+    struct Change
+    {
+        Book book;
+        bool present = true;
+        bool text_changed = true; // Title or author may differ, not just circulation.
+    };
+
+    SharedCatalog() = default;
+    ~SharedCatalog();
+
+    SharedCatalog(const SharedCatalog &) = delete;
+    SharedCatalog &operator=(const SharedCatalog &) = delete;
+
+    // Maps the existing segment `name` (e.g. "/library-catalog"). False if
+    // there is none yet or it is not a catalog.
+    bool attach(const std::string &name);
+    // Creates `name` with room for `capacity` books, holding `seed` (with the
+    // copy ids it has) before any other process can see it. Fails without
+    // creating anything if `seed` does not fit; `exists` is set if another
+    // process created the segment first (attach to it instead).
+    bool create(const std::string &name, size_t capacity, const std::vector<Book> &seed, bool &exists);
+    void close();
+    bool isOpen() const { return m_base != nullptr; }
+
+    static bool fits(const Book &book);
+
+    size_t capacity() const;
+    // Lock-free; changes whenever a process has published a change.
+    uint64_t generation() const;
+
+    // Lock-free: reads the record of copy `copy_id` of `isbn`. False if it is not
+    // (or, as far as this process has caught up, no longer) in the catalog.
+    bool find(const std::string &isbn, int32_t copy_id, Book &out) const;
+
+    // Lock-free: every record. This process has then seen everything up to
+    // now, so changes() only reports what comes after.
+    bool read(std::vector<Book> &books);
+
+    // Appends what other processes changed since this process last looked
+    // (read(), changes() or apply()), removals first. False if more changes
+    // were made than the log holds; call read() for the whole catalog instead.
+    bool changes(std::vector<Change> &changes);
+
+    // Under the writer lock: checks every edit against the segment and, only if
+    // all of them hold, applies them in order, each one a separate seqlock-
+    // protected write. A process that dies part way through leaves the edits it
+    // finished in place and its current one rolled back. `earlier` gets what
+    // other processes changed before these edits (changes() does not report it again).
+    Result apply(std::vector<Edit> &edits, std::vector<Change> &earlier);
+
+private:
+    using Key = std::pair<std::string, int32_t>;
+
+    bool map(int fd, bool created);
+    // Appends log entries after m_generation to `changes` and moves the key
+    // index up to date; false on a log overflow.
+    bool catchUp(std::vector<Change> &changes);
+    // Rebuilds the key index from every slot; under the writer lock only.
+    void indexSlots();
+    void remember(uint32_t slot, const Key &key);
+    bool findSlot(const Key &key, uint32_t &slot) const;
+
+    void *m_base = nullptr; // Start of the mapping; the layout lives in SharedCatalog.cpp.
+    size_t m_mapped_bytes = 0;
+    // This process's key index over the slots, as of m_generation.
+    std::map<Key, uint32_t> m_slot_of;
+    std::vector<Key> m_key_of; // By slot; empty ISBN for a free slot.
+    uint64_t m_generation = 0;
+    bool m_overflowed = false; // apply() had to skip changes it could not catch up on.
+};
+
+#endif // SHAREDCATALOG_H
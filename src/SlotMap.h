@@ -0,0 +1,185 @@
+#ifndef SLOTMAP_H
+#define SLOTMAP_H
+
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Record storage with stable addresses and checkable handles.
+// Records live in fixed-size chunks that are never reallocated, so a record
+// never moves while it exists. Each slot carries a generation that is bumped
+// when its record is erased; a Handle remembers the generation it was issued
+// for, so a handle to an erased (or erased and reused) slot resolves to
+// nullptr instead of to the wrong record. Slot indexes are dense 32-bit ids
+// that indexes can store instead of copies of the key.
+template <typename T>
+class SlotMap
+{
+public:
+    struct Handle
+    {
+        uint32_t index = UINT32_MAX;
+        uint32_t generation = 0;
+
+        bool isNull() const { return index == UINT32_MAX; }
+        bool operator==(const Handle &other) const { return index == other.index && generation == other.generation; }
+        bool operator!=(const Handle &other) const { return !(*this == other); }
+    };
+
+    static const uint32_t CHUNK_SIZE = 256;
+
+    // Visits live records in slot order. index() is the slot id of the current record.
+    template <typename Map, typename Value>
+    class BasicIterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Value *;
+        using reference = Value &;
+
+        BasicIterator(Map *map, uint32_t index) : m_map(map), m_index(index) { skipDead(); }
+
+        reference operator*() const { return *m_map->slot(m_index).value; }
+        pointer operator->() const { return &*m_map->slot(m_index).value; }
+        uint32_t index() const { return m_index; }
+
+        BasicIterator &operator++()
+        {
+            ++m_index;
+            skipDead();
+            return *this;
+        }
+        bool operator==(const BasicIterator &other) const { return m_index == other.m_index; }
+        bool operator!=(const BasicIterator &other) const { return m_index != other.m_index; }
+
+    private:
+        void skipDead()
+        {
+            while (m_index < m_map->m_slot_count && !m_map->slot(m_index).value)
+                ++m_index;
+        }
+
+        Map *m_map;
+        uint32_t m_index;
+    };
+    using iterator = BasicIterator<SlotMap, T>;
+    using const_iterator = BasicIterator<const SlotMap, const T>;
+
+    Handle insert(T value)
+    {
+        uint32_t index;
+        if (!m_free.empty())
+        {
+            index = m_free.back();
+            m_free.pop_back();
+        }
+        else
+        {
+            index = m_slot_count++;
+            if (index / CHUNK_SIZE >= m_chunks.size())
+                m_chunks.emplace_back(new Slot[CHUNK_SIZE]);
+        }
+        Slot &target = slot(index);
+        target.value.emplace(std::move(value));
+        m_size++;
+        return {index, target.generation};
+    }
+
+    // Returns false if the handle is stale.
+    bool erase(Handle handle)
+    {
+        if (get(handle) == nullptr)
+            return false;
+        eraseAt(handle.index);
+        return true;
+    }
+
+    // Erases every record matching `predicate`; returns how many were erased.
+    template <typename Predicate>
+    size_t eraseIf(Predicate predicate)
+    {
+        size_t erased = 0;
+        for (uint32_t i = 0; i < m_slot_count; ++i)
+        {
+            if (slot(i).value && predicate(*slot(i).value))
+            {
+                eraseAt(i);
+                erased++;
+            }
+        }
+        return erased;
+    }
+
+    // Erases everything and invalidates every handle. Slots are reused from id 0 upwards.
+    void clear()
+    {
+        m_free.clear();
+        for (uint32_t i = m_slot_count; i-- > 0;)
+        {
+            Slot &target = slot(i);
+            if (target.value)
+            {
+                target.value.reset();
+                target.generation++;
+            }
+            m_free.push_back(i);
+        }
+        m_size = 0;
+    }
+
+    T *get(Handle handle)
+    {
+        if (handle.index >= m_slot_count)
+            return nullptr;
+        Slot &target = slot(handle.index);
+        return (target.value && target.generation == handle.generation) ? &*target.value : nullptr;
+    }
+    const T *get(Handle handle) const { return const_cast<SlotMap *>(this)->get(handle); }
+
+    // Slot id access for indexes; the slot must be live.
+    T &operator[](uint32_t index) { return *slot(index).value; }
+    const T &operator[](uint32_t index) const { return *slot(index).value; }
+    Handle handleAt(uint32_t index) const { return {index, slot(index).generation}; }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    // One past the highest slot id ever used; sizes arrays indexed by slot id.
+    uint32_t slotCount() const { return m_slot_count; }
+    size_t memoryBytes() const { return m_chunks.size() * CHUNK_SIZE * sizeof(Slot) + m_free.capacity() * sizeof(uint32_t); }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, m_slot_count); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, m_slot_count); }
+
+private:
+    struct Slot
+    {
+        std::optional<T> value;
+        uint32_t generation = 0;
+    };
+
+    Slot &slot(uint32_t index) { return m_chunks[index / CHUNK_SIZE][index % CHUNK_SIZE]; }
+    const Slot &slot(uint32_t index) const { return m_chunks[index / CHUNK_SIZE][index % CHUNK_SIZE]; }
+
+    void eraseAt(uint32_t index)
+    {
+        Slot &target = slot(index);
+        target.value.reset();
+        target.generation++;
+        m_free.push_back(index);
+        m_size--;
+    }
+
+    std::vector<std::unique_ptr<Slot[]>> m_chunks;
+    std::vector<uint32_t> m_free; // Stack of erased slot ids.
+    uint32_t m_slot_count = 0;
+    size_t m_size = 0;
+};
+
+#endif // SLOTMAP_H
@@ -0,0 +1,272 @@
+#include "TitleDictionary.h"
+
+#include <algorithm>
+
+namespace
+{
+    void putVarint(std::vector<uint8_t> &out, size_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    size_t getVarint(const std::vector<uint8_t> &in, size_t &offset)
+    {
+        size_t value = 0;
+        int shift = 0;
+        while (true)
+        {
+            uint8_t byte = in[offset++];
+            value |= static_cast<size_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+            shift += 7;
+        }
+    }
+
+    size_t decodeFrom(const std::vector<uint8_t> &data, size_t offset, std::string &previous)
+    {
+        size_t shared = getVarint(data, offset);
+        size_t suffix = getVarint(data, offset);
+        previous.resize(shared);
+        previous.append(reinterpret_cast<const char *>(data.data() + offset), suffix);
+        return offset + suffix;
+    }
+
+    // The overlay is merged in once it holds this many titles, or a sixteenth of the dictionary if that is more.
+    const size_t MIN_COMPACTION = 1024;
+}
+
+const uint32_t TitleDictionary::NONE;
+
+void TitleDictionary::clear()
+{
+    m_data.clear();
+    m_restarts.clear();
+    m_ids.clear();
+    m_positions.clear();
+    m_pending.clear();
+    m_last.clear();
+    m_dead = 0;
+    m_raw_bytes = 0;
+}
+
+void TitleDictionary::add(const std::string &title, uint32_t id)
+{
+    size_t shared = 0;
+    if (m_ids.size() % BLOCK_SIZE == 0)
+    {
+        m_restarts.push_back(static_cast<uint32_t>(m_data.size()));
+    }
+    else
+    {
+        size_t limit = std::min(title.size(), m_last.size());
+        while (shared < limit && title[shared] == m_last[shared])
+            shared++;
+    }
+    putVarint(m_data, shared);
+    putVarint(m_data, title.size() - shared);
+    m_data.insert(m_data.end(), title.begin() + shared, title.end());
+
+    if (id >= m_positions.size())
+        m_positions.resize(id + 1, NONE);
+    m_positions[id] = static_cast<uint32_t>(m_ids.size());
+    m_ids.push_back(id);
+    m_last = title;
+    m_raw_bytes += title.size();
+}
+
+void TitleDictionary::kill(uint32_t id)
+{
+    auto pending = m_pending.find(id);
+    if (pending != m_pending.end())
+    {
+        m_raw_bytes -= pending->second.size();
+        m_pending.erase(pending);
+        return;
+    }
+    uint32_t position = positionOf(id);
+    if (position == NONE)
+        return;
+    std::string old;
+    decodeAt(position, old);
+    m_raw_bytes -= old.size();
+    m_positions[id] = NONE;
+    m_dead++;
+}
+
+void TitleDictionary::set(uint32_t id, const std::string &title)
+{
+    kill(id);
+    m_pending[id] = title;
+    m_raw_bytes += title.size();
+    compactIfNeeded();
+}
+
+void TitleDictionary::erase(uint32_t id)
+{
+    kill(id);
+    compactIfNeeded();
+}
+
+void TitleDictionary::compactIfNeeded()
+{
+    if (m_pending.size() + m_dead > std::max(MIN_COMPACTION, m_ids.size() / 16))
+        compact();
+}
+
+bool TitleDictionary::contains(uint32_t id) const
+{
+    return positionOf(id) != NONE || m_pending.count(id) != 0;
+}
+
+std::string TitleDictionary::title(uint32_t id) const
+{
+    std::string out;
+    title(id, out);
+    return out;
+}
+
+void TitleDictionary::title(uint32_t id, std::string &out) const
+{
+    auto pending = m_pending.find(id);
+    if (pending != m_pending.end())
+    {
+        out = pending->second;
+        return;
+    }
+    uint32_t position = positionOf(id);
+    if (position == NONE)
+        out.clear();
+    else
+        decodeAt(position, out);
+}
+
+int TitleDictionary::compare(uint32_t a, uint32_t b) const
+{
+    uint32_t position_a = positionOf(a), position_b = positionOf(b);
+    if (position_a != NONE && position_b != NONE)
+        return position_a < position_b ? -1 : position_a > position_b ? 1 : 0;
+    std::string title_a, title_b;
+    title(a, title_a);
+    title(b, title_b);
+    int order = title_a.compare(title_b);
+    if (order != 0)
+        return order;
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+void TitleDictionary::compact()
+{
+    if (compacted())
+        return;
+    std::vector<std::pair<std::string, uint32_t>> pending;
+    pending.reserve(m_pending.size());
+    for (auto &entry : m_pending)
+        pending.emplace_back(std::move(entry.second), entry.first);
+    std::sort(pending.begin(), pending.end());
+
+    std::vector<uint8_t> data;
+    std::vector<uint32_t> ids, positions;
+    data.swap(m_data);
+    ids.swap(m_ids);
+    positions.swap(m_positions);
+    clear();
+    m_data.reserve(data.size());
+    m_ids.reserve(ids.size() + pending.size());
+
+    // Both sides are already in (title, id) order, so this is one merge pass.
+    auto next = pending.begin();
+    std::string title;
+    size_t offset = 0;
+    for (size_t position = 0; position < ids.size(); ++position)
+    {
+        offset = decodeFrom(data, offset, title);
+        uint32_t id = ids[position];
+        if (positions[id] != position)
+            continue;
+        for (; next != pending.end() && (next->first < title || (next->first == title && next->second < id)); ++next)
+            add(next->first, next->second);
+        add(title, id);
+    }
+    for (; next != pending.end(); ++next)
+        add(next->first, next->second);
+}
+
+void TitleDictionary::decodeAt(size_t position, std::string &out) const
+{
+    size_t offset = m_restarts[position / BLOCK_SIZE];
+    out.clear();
+    for (size_t skip = position % BLOCK_SIZE + 1; skip > 0; --skip)
+        offset = decodeEntry(offset, out);
+}
+
+size_t TitleDictionary::decodeEntry(size_t offset, std::string &previous) const
+{
+    return decodeFrom(m_data, offset, previous);
+}
+
+void TitleDictionary::decodeRange(size_t start, size_t end, std::vector<std::string> &titles) const
+{
+    titles.clear();
+    end = std::min(end, m_ids.size());
+    if (start >= end)
+        return;
+
+    size_t position = (start / BLOCK_SIZE) * BLOCK_SIZE;
+    size_t offset = m_restarts[start / BLOCK_SIZE];
+    std::string current;
+    for (; position < end; ++position)
+    {
+        offset = decodeEntry(offset, current);
+        if (position >= start)
+            titles.push_back(current);
+    }
+}
+
+size_t TitleDictionary::lowerBound(const std::string &key) const
+{
+    if (m_restarts.empty())
+        return 0;
+
+    // Last block whose first title is < key; the answer lies in it or starts the next one.
+    size_t lo = 0, hi = m_restarts.size();
+    std::string title;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        title.clear();
+        decodeEntry(m_restarts[mid], title);
+        if (title < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return 0;
+
+    size_t block = lo - 1;
+    size_t position = block * BLOCK_SIZE;
+    size_t end = std::min(position + BLOCK_SIZE, m_ids.size());
+    size_t offset = m_restarts[block];
+    title.clear();
+    for (; position < end; ++position)
+    {
+        offset = decodeEntry(offset, title);
+        if (!(title < key))
+            return position;
+    }
+    return end;
+}
+
+size_t TitleDictionary::encodedBytes() const
+{
+    size_t bytes = m_data.capacity() + (m_restarts.capacity() + m_ids.capacity() + m_positions.capacity()) * sizeof(uint32_t);
+    for (const auto &entry : m_pending)
+        bytes += sizeof(entry) + entry.second.capacity();
+    return bytes;
+}
@@ -0,0 +1,76 @@
+#ifndef TITLEDICTIONARY_H
+#define TITLEDICTIONARY_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The catalog's titles, keyed by book slot id and stored front-coded in
+// (title, id) order: each title keeps only the bytes that differ from the
+// title before it ("A Brief History of T" + "oasters"). Every BLOCK_SIZE-th
+// title is stored whole as a restart point, so any title can be reached by
+// decoding at most one block, and binary search only touches the restart
+// titles plus one block.
+// Titles set after the bulk build wait in a small overlay (and the ones they
+// replace are marked dead) until compact() merges them in, which happens on
+// its own once the overlay grows past a fraction of the dictionary.
+class TitleDictionary
+{
+public:
+    static const size_t BLOCK_SIZE = 16;
+    static const uint32_t NONE = UINT32_MAX;
+
+    void clear();
+    // Bulk build: titles must be added in (title, id) order, each id once.
+    void add(const std::string &title, uint32_t id);
+    // Sets or replaces the title of `id`.
+    void set(uint32_t id, const std::string &title);
+    void erase(uint32_t id);
+
+    bool contains(uint32_t id) const;
+    std::string title(uint32_t id) const;
+    // Decodes into `out`, reusing its buffer.
+    void title(uint32_t id, std::string &out) const;
+    // Negative, zero or positive as (title, id) of `a` sorts before, equal to or after `b`'s.
+    int compare(uint32_t a, uint32_t b) const;
+
+    // Number of titles.
+    size_t size() const { return m_ids.size() - m_dead + m_pending.size(); }
+
+    // Merges the overlay in and drops dead titles. The positional calls below
+    // (idAt, decodeRange, lowerBound) are only valid while compacted().
+    bool compacted() const { return m_pending.empty() && m_dead == 0; }
+    void compact();
+
+    uint32_t idAt(size_t position) const { return m_ids[position]; }
+    // Decodes titles [start, end) into `titles`, touching only the blocks that overlap the range.
+    void decodeRange(size_t start, size_t end, std::vector<std::string> &titles) const;
+    // Position of the first title >= key.
+    size_t lowerBound(const std::string &key) const;
+
+    // Everything the dictionary holds, including the id maps and the overlay.
+    size_t encodedBytes() const;
+    // Bytes of the titles themselves.
+    size_t rawBytes() const { return m_raw_bytes; }
+
+private:
+    // Decodes the entry at `offset` on top of `previous` and returns the next offset.
+    size_t decodeEntry(size_t offset, std::string &previous) const;
+    void decodeAt(size_t position, std::string &out) const;
+    uint32_t positionOf(uint32_t id) const { return id < m_positions.size() ? m_positions[id] : NONE; }
+    // Marks the encoded title of `id`, if any, as dead.
+    void kill(uint32_t id);
+    void compactIfNeeded();
+
+    std::vector<uint8_t> m_data;
+    std::vector<uint32_t> m_restarts;  // Byte offset of each block's first (whole) title.
+    std::vector<uint32_t> m_ids;       // Position -> id.
+    std::vector<uint32_t> m_positions; // Id -> position, or NONE if not encoded (or dead).
+    std::unordered_map<uint32_t, std::string> m_pending; // Titles set since the last compaction.
+    std::string m_last;
+    size_t m_dead = 0;
+    size_t m_raw_bytes = 0;
+};
+
+#endif // TITLEDICTIONARY_H
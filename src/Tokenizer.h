@@ -0,0 +1,31 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <cctype>
+#include <string>
+#include <vector>
+
+// Splits text into lowercase words made of letters and digits.
+// Shared by the search indexes so they agree on what a "word" is.
+inline std::vector<std::string> tokenizeText(const std::string &text)
+{
+    std::vector<std::string> tokens;
+    std::string current;
+    for (unsigned char c : text)
+    {
+        if (std::isalnum(c))
+        {
+            current += static_cast<char>(std::tolower(c));
+        }
+        else if (!current.empty())
+        {
+            tokens.push_back(current);
+            current.clear();
+        }
+    }
+    if (!current.empty())
+        tokens.push_back(current);
+    return tokens;
+}
+
+#endif // TOKENIZER_H
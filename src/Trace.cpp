@@ -0,0 +1,176 @@
+#include "Trace.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "colors.hpp"
+
+namespace
+{
+    struct TraceEvent
+    {
+        const char *name;
+        int64_t start_us;
+        int64_t duration_us;
+    };
+
+    // One ring per thread, grown on demand up to CAPACITY, so short-lived worker
+    // threads that record a span or two cost a few bytes rather than a full ring.
+    // When it wraps, the oldest spans are dropped so a long session never grows
+    // memory; the newest spans are the useful ones.
+    struct ThreadBuffer
+    {
+        static const size_t CAPACITY = 1 << 16;
+
+        explicit ThreadBuffer(int tid) : tid(tid) {}
+
+        int tid;
+        std::mutex mutex; // Only contended while flushing.
+        std::vector<TraceEvent> events;
+        size_t next = 0;
+        size_t count = 0;
+        uint64_t dropped = 0;
+    };
+
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        std::string output_path;
+        bool flushed = false;
+    };
+
+    Registry &registry()
+    {
+        static Registry *instance = new Registry(); // Never destroyed: used from atexit.
+        return *instance;
+    }
+
+    ThreadBuffer &threadBuffer()
+    {
+        thread_local std::shared_ptr<ThreadBuffer> buffer;
+        if (!buffer)
+        {
+            Registry &reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            buffer = std::make_shared<ThreadBuffer>(static_cast<int>(reg.buffers.size()) + 1);
+            reg.buffers.push_back(buffer);
+        }
+        return *buffer;
+    }
+
+    void writeJsonString(std::ostream &out, const char *text)
+    {
+        out << '"';
+        for (const char *p = text; *p != '\0'; ++p)
+        {
+            if (*p == '"' || *p == '\\')
+                out << '\\';
+            out << *p;
+        }
+        out << '"';
+    }
+
+    void flushAtExit()
+    {
+        Trace::flush();
+    }
+}
+
+bool Trace::enabled()
+{
+    static const bool is_enabled = []
+    {
+        const char *path = std::getenv("LIBRARY_TRACE_FILE");
+        if (path == nullptr || *path == '\0')
+            return false;
+        registry().output_path = path;
+        std::atexit(flushAtExit);
+        return true;
+    }();
+    return is_enabled;
+}
+
+int64_t Trace::nowMicros()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void Trace::record(const char *name, int64_t start_us, int64_t duration_us)
+{
+    ThreadBuffer &buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if (buffer.events.size() < ThreadBuffer::CAPACITY)
+        buffer.events.push_back({name, start_us, duration_us});
+    else
+        buffer.events[buffer.next] = {name, start_us, duration_us};
+    buffer.next = (buffer.next + 1) % ThreadBuffer::CAPACITY;
+    if (buffer.count < ThreadBuffer::CAPACITY)
+        buffer.count++;
+    else
+        buffer.dropped++;
+}
+
+void Trace::flush()
+{
+    if (!enabled())
+        return;
+    Registry &reg = registry();
+    std::lock_guard<std::mutex> reg_lock(reg.mutex);
+    if (reg.flushed)
+        return;
+    reg.flushed = true;
+
+    std::ofstream out(reg.output_path);
+    if (!out.is_open())
+    {
+        std::cerr << Color::BOLD_RED << "ERROR: Could not write trace file: " << reg.output_path << Color::RESET << std::endl;
+        return;
+    }
+
+    const int pid = static_cast<int>(getpid());
+    bool first = true;
+    out << "{\"traceEvents\":[";
+    for (const auto &buffer : reg.buffers)
+    {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        // A buffer is only created by record(), so it holds at least one event.
+        const size_t size = buffer->events.size();
+        size_t oldest = (buffer->next + size - buffer->count) % size;
+        for (size_t i = 0; i < buffer->count; ++i)
+        {
+            const TraceEvent &event = buffer->events[(oldest + i) % size];
+            out << (first ? "\n" : ",\n") << "{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"ph\":\"X\",\"ts\":" << event.start_us << ",\"dur\":" << event.duration_us
+                << ",\"pid\":" << pid << ",\"tid\":" << buffer->tid << "}";
+            first = false;
+        }
+        if (buffer->dropped > 0)
+        {
+            out << (first ? "\n" : ",\n") << "{\"name\":\"dropped_spans\",\"ph\":\"i\",\"s\":\"t\",\"ts\":0"
+                << ",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+                << ",\"args\":{\"count\":" << buffer->dropped << "}}";
+            first = false;
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+TraceSpan::TraceSpan(const char *name)
+    : m_name(name), m_start_us(Trace::enabled() ? Trace::nowMicros() : 0)
+{
+}
+
+TraceSpan::~TraceSpan()
+{
+    if (Trace::enabled())
+        Trace::record(m_name, m_start_us, Trace::nowMicros() - m_start_us);
+}
@@ -0,0 +1,34 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+
+// Optional Chrome trace_event output.
+// Set the LIBRARY_TRACE_FILE environment variable to a path and every TraceSpan
+// is recorded into a per-thread ring buffer. The buffers are written out as one
+// JSON file when the program exits, ready to open in Perfetto or chrome://tracing.
+namespace Trace
+{
+    bool enabled();
+    int64_t nowMicros();
+    void record(const char *name, int64_t start_us, int64_t duration_us);
+    void flush();
+}
+
+// Records one complete ("X") event covering the lifetime of the object.
+// The name must be a string literal (only the pointer is stored).
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char *name);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+    const char *m_name;
+    int64_t m_start_us;
+};
+
+#endif // TRACE_H
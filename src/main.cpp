@@ -3,6 +3,10 @@
 #include <iostream>
 #include <string>
 #include <limits>
+#include <cstdlib>
+#include <sstream>
+#include <utility>
+#include <vector>
 #include "colors.hpp"
 
 // --- Helper Functions for UI ---
@@ -42,6 +46,23 @@ void showLibrarianMenu()
               << "8. Remove User\n"
               << "10. Display All Users\n"
               << "11. Search for a User\n"
+              << Color::CYAN << "--- Circulation and Search ---\n"
+              << Color::RESET
+              << "12. Check Out Several Books\n"
+              << "13. Return Several Books\n"
+              << "14. Cancel a Hold\n"
+              << "15. Fuzzy Search (typos allowed)\n"
+              << "16. Filter Books (availability / author / borrower)\n"
+              << Color::CYAN << "--- Reports ---\n"
+              << Color::RESET
+              << "17. Export Catalog (CSV / JSON Lines)\n"
+              << "18. Overdue Report\n"
+              << "19. Due Today\n"
+              << Color::CYAN << "--- System ---\n"
+              << Color::RESET
+              << "20. Search Cache Statistics\n"
+              << "21. Memory Report\n"
+              << "22. Replication Status\n"
               << "-----------------------\n"
               << "9. Logout\n"
               << "-----------------------\n"
@@ -57,11 +78,34 @@ void showMemberMenu()
               << "2. Search for a Book\n"
               << "3. Check Out a Book\n"
               << "4. Return a Book\n"
+              << "5. Fuzzy Search (typos allowed)\n"
+              << "6. Cancel a Hold\n"
+              << "7. Check Out Several Books\n"
+              << "8. Return Several Books\n"
+              << "10. Filter Books (availability / author / borrower)\n"
               << "9. Logout\n"
               << "---------------------\n"
               << Color::BOLD_YELLOW << "Enter your choice: " << Color::RESET;
 }
 
+void showReplicaMenu()
+{
+    std::cout << "\n"
+              << Color::BOLD_CYAN << "--- Replica Menu (read-only) ---\n"
+              << Color::RESET
+              << "1. Display All Books\n"
+              << "2. Search for a Book\n"
+              << "3. Fuzzy Search (typos allowed)\n"
+              << "4. Overdue Report\n"
+              << "5. Due Today\n"
+              << "6. Export Catalog (CSV / JSON Lines)\n"
+              << "7. Replication Status\n"
+              << "8. Filter Books (availability / author / borrower)\n"
+              << "9. Logout\n"
+              << "--------------------------------\n"
+              << Color::BOLD_YELLOW << "Enter your choice: " << Color::RESET;
+}
+
 // --- Main Application Logic ---
 void librarianSession(LibraryManager &manager)
 {
@@ -80,6 +124,7 @@ void librarianSession(LibraryManager &manager)
             pauseScreen();
             continue;
         }
+        manager.pollDataFiles(); // Apply outside edits made while the menu was waiting.
         switch (choice)
         {
         case 1:
@@ -95,7 +140,6 @@ void librarianSession(LibraryManager &manager)
             break;
         case 4:
             manager.searchBookByTitle();
-            pauseScreen();
             break;
         case 5:
             manager.checkOutBook();
@@ -118,9 +162,52 @@ void librarianSession(LibraryManager &manager)
             break; // <-- The only change in this file
         case 11:
             manager.searchUserByUsername();
+            break;
+        case 12:
+            manager.checkOutBasket();
+            pauseScreen();
+            break;
+        case 13:
+            manager.returnBasket();
+            pauseScreen();
+            break;
+        case 14:
+            manager.cancelHold();
+            pauseScreen();
+            break;
+        case 15:
+            manager.fuzzySearchBooks();
+            pauseScreen();
+            break;
+        case 16:
+            manager.filterBooks();
+            break;
+        case 17:
+            manager.exportCatalog();
+            pauseScreen();
+            break;
+        case 18:
+            manager.displayOverdueBooks();
+            pauseScreen();
+            break;
+        case 19:
+            manager.displayDueToday();
+            pauseScreen();
+            break;
+        case 20:
+            manager.displaySearchCacheStats();
+            pauseScreen();
+            break;
+        case 21:
+            manager.displayMemoryReport();
+            pauseScreen();
+            break;
+        case 22:
+            manager.displayReplicationStatus();
             pauseScreen();
             break;
         case 9:
+            manager.flushPendingWrites();
             std::cout << Color::YELLOW << "Logging out...\n"
                       << Color::RESET;
             pauseScreen();
@@ -151,6 +238,7 @@ void memberSession(LibraryManager &manager)
             pauseScreen();
             continue;
         }
+        manager.pollDataFiles(); // Apply outside edits made while the menu was waiting.
         switch (choice)
         {
         case 1:
@@ -158,7 +246,6 @@ void memberSession(LibraryManager &manager)
             break;
         case 2:
             manager.searchBookByTitle();
-            pauseScreen();
             break;
         case 3:
             manager.checkOutBook();
@@ -168,6 +255,90 @@ void memberSession(LibraryManager &manager)
             manager.returnBook();
             pauseScreen();
             break;
+        case 5:
+            manager.fuzzySearchBooks();
+            pauseScreen();
+            break;
+        case 6:
+            manager.cancelHold();
+            pauseScreen();
+            break;
+        case 7:
+            manager.checkOutBasket();
+            pauseScreen();
+            break;
+        case 8:
+            manager.returnBasket();
+            pauseScreen();
+            break;
+        case 10:
+            manager.filterBooks();
+            break;
+        case 9:
+            manager.flushPendingWrites();
+            std::cout << Color::YELLOW << "Logging out...\n"
+                      << Color::RESET;
+            pauseScreen();
+            break;
+        default:
+            std::cout << Color::BOLD_RED << "Invalid choice. Please try again.\n"
+                      << Color::RESET;
+            pauseScreen();
+            break;
+        }
+    }
+}
+
+// Everyone gets the same read-only menu on a replica; changes are made on the primary.
+void replicaSession(LibraryManager &manager)
+{
+    int choice = 0;
+    while (choice != 9)
+    {
+        clearScreen();
+        showReplicaMenu();
+        std::cin >> choice;
+        if (std::cin.fail())
+        {
+            std::cout << Color::BOLD_RED << "Invalid input. Please enter a number.\n"
+                      << Color::RESET;
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            pauseScreen();
+            continue;
+        }
+        manager.pollDataFiles(); // Apply the primary's changes that arrived while the menu was waiting.
+        switch (choice)
+        {
+        case 1:
+            manager.displayAllBooks();
+            break;
+        case 2:
+            manager.searchBookByTitle();
+            break;
+        case 3:
+            manager.fuzzySearchBooks();
+            pauseScreen();
+            break;
+        case 4:
+            manager.displayOverdueBooks();
+            pauseScreen();
+            break;
+        case 5:
+            manager.displayDueToday();
+            pauseScreen();
+            break;
+        case 6:
+            manager.exportCatalog();
+            pauseScreen();
+            break;
+        case 7:
+            manager.displayReplicationStatus();
+            pauseScreen();
+            break;
+        case 8:
+            manager.filterBooks();
+            break;
         case 9:
             std::cout << Color::YELLOW << "Logging out...\n"
                       << Color::RESET;
@@ -184,7 +355,71 @@ void memberSession(LibraryManager &manager)
 
 int main()
 {
-    LibraryManager myLibrary("../data/books.csv", "../data/users.csv");
+    // Read-only replica of another process: LIBRARY_REPLICA_OF=<socket path>.
+    // A replica keeps no files of its own, so the storage options below do not apply.
+    const char *replica_of = std::getenv("LIBRARY_REPLICA_OF");
+    // Optional B+tree page store: LIBRARY_PAGE_STORE=<file> [LIBRARY_PAGE_POOL=<pages>]
+    const char *page_store = replica_of == nullptr ? std::getenv("LIBRARY_PAGE_STORE") : nullptr;
+    // Optional shared catalog for several desks on one host:
+    // LIBRARY_SHARED_CATALOG=/name [LIBRARY_SHARED_CAPACITY=<books>]
+    const char *shared_catalog = replica_of == nullptr ? std::getenv("LIBRARY_SHARED_CATALOG") : nullptr;
+    if (page_store != nullptr && shared_catalog != nullptr)
+    {
+        std::cerr << Color::BOLD_RED << "ERROR: LIBRARY_PAGE_STORE and LIBRARY_SHARED_CATALOG cannot be used together." << Color::RESET << std::endl;
+        return 1;
+    }
+
+    // A desk attaching to a shared catalog reads the books from the segment, not the file.
+    LibraryManager myLibrary("../data/books.csv", "../data/users.csv", "../data/holds.csv", shared_catalog == nullptr);
+
+    if (const char *cache_bytes = std::getenv("LIBRARY_SEARCH_CACHE_BYTES"))
+    {
+        myLibrary.setSearchCacheBudget(std::strtoul(cache_bytes, nullptr, 10));
+    }
+
+    if (replica_of != nullptr && !myLibrary.enableReplica(replica_of))
+        return 1;
+
+    if (page_store != nullptr)
+    {
+        const char *pool = std::getenv("LIBRARY_PAGE_POOL");
+        size_t pool_pages = pool ? std::strtoul(pool, nullptr, 10) : 256;
+        if (!myLibrary.enablePageStore(page_store, pool_pages))
+            return 1;
+    }
+
+    if (shared_catalog != nullptr)
+    {
+        const char *capacity = std::getenv("LIBRARY_SHARED_CAPACITY");
+        size_t capacity_books = capacity ? std::strtoul(capacity, nullptr, 10) : 65536;
+        if (!myLibrary.enableSharedCatalog(shared_catalog, capacity_books))
+            return 1;
+    }
+
+    // Other branches to list and search alongside ours, read-only:
+    // LIBRARY_BRANCHES=name=<data dir>,name=<data dir>,...
+    if (const char *branch_list = std::getenv("LIBRARY_BRANCHES"))
+    {
+        std::vector<std::pair<std::string, std::string>> branches;
+        std::stringstream entries(branch_list);
+        std::string entry;
+        while (std::getline(entries, entry, ','))
+        {
+            size_t equals = entry.find('=');
+            if (equals == std::string::npos || equals == 0 || equals + 1 == entry.size())
+            {
+                std::cerr << Color::BOLD_RED << "ERROR: LIBRARY_BRANCHES entries must look like name=directory: " << entry << Color::RESET << std::endl;
+                return 1;
+            }
+            branches.emplace_back(entry.substr(0, equals), entry.substr(equals + 1));
+        }
+        myLibrary.mountBranches(branches); // Branches that cannot be read are reported and skipped.
+    }
+
+    // Stream catalog changes to replicas: LIBRARY_REPLICATION_SOCKET=<socket path>
+    const char *replication_socket = std::getenv("LIBRARY_REPLICATION_SOCKET");
+    if (replication_socket != nullptr && replica_of == nullptr && !myLibrary.enableReplicationPrimary(replication_socket))
+        return 1;
 
     while (true)
     {
@@ -194,8 +429,8 @@ int main()
         std::cout << Color::BOLD_BLUE << "=========================================\n"
                   << Color::RESET;
 
-        User *currentUser = nullptr;
-        while (currentUser == nullptr)
+        LibraryManager::UserHandle currentUser;
+        while (currentUser.isNull())
         {
             std::string username, password;
             std::cout << "\n"
@@ -206,6 +441,12 @@ int main()
 
             if (username == "exit")
             {
+                if (!myLibrary.flushPendingWrites())
+                {
+                    std::cout << Color::BOLD_RED << "Exiting with unsaved changes.\n"
+                              << Color::RESET;
+                    return 1;
+                }
                 std::cout << "Thank you for using the system. Goodbye!\n";
                 return 0;
             }
@@ -213,9 +454,10 @@ int main()
             std::cout << Color::YELLOW << "Enter password: " << Color::RESET;
             std::cin >> password;
 
+            myLibrary.pollDataFiles();
             currentUser = myLibrary.validateUser(username, password);
 
-            if (currentUser == nullptr)
+            if (currentUser.isNull())
             {
                 std::cout << "\n"
                           << Color::BOLD_RED << "Login failed. Please check your credentials and try again.\n"
@@ -223,12 +465,19 @@ int main()
             }
         }
 
+        // Resolve the handle once; the record can be removed later in the session.
+        const User *user = myLibrary.findUser(currentUser);
+        UserRole role = user->getRole();
         clearScreen();
-        std::cout << Color::BOLD_GREEN << "Login successful! Welcome, " << currentUser->getUsername() << ".\n"
+        std::cout << Color::BOLD_GREEN << "Login successful! Welcome, " << user->getUsername() << ".\n"
                   << Color::RESET;
         pauseScreen();
 
-        if (currentUser->getRole() == UserRole::LIBRARIAN)
+        if (myLibrary.isReplica())
+        {
+            replicaSession(myLibrary);
+        }
+        else if (role == UserRole::LIBRARIAN)
         {
             librarianSession(myLibrary);
         }
@@ -0,0 +1,129 @@
+// Allocation budgets for the load and search hot paths.
+// Built with LIBRARY_ALLOC_STATS and run by ctest: loading a generated catalog
+// and searching it must stay within the heap-allocation counts below, so an
+// allocation regression on these paths fails the build.
+
+#include "LibraryManager.h"
+#include "AllocStats.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+namespace
+{
+    const size_t BOOK_COUNT = 20000;
+
+    // Heap allocations per row of books.csv while the catalog loads (parsing,
+    // the slot map, the ISBN index, loans and the title dictionary together).
+    const double LOAD_ALLOCATIONS_PER_ROW = 3.0;
+    // Heap allocations for one uncached search, whatever the catalog size or the number of matches.
+    const uint64_t SEARCH_ALLOCATIONS = 40;
+    // Heap allocations for repeating a search that is in the cache.
+    const uint64_t CACHED_SEARCH_ALLOCATIONS = 4;
+
+    uint64_t allocations(std::initializer_list<AllocStats::Subsystem> subsystems)
+    {
+        uint64_t total = 0;
+        for (auto subsystem : subsystems)
+            total += AllocStats::counters(subsystem).allocations;
+        return total;
+    }
+
+    uint64_t allAllocations()
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i < static_cast<size_t>(AllocStats::Subsystem::COUNT); ++i)
+            total += AllocStats::counters(static_cast<AllocStats::Subsystem>(i)).allocations;
+        return total;
+    }
+
+    // Titles long enough to need their own heap block, a tenth of them sharing the word "history".
+    void writeCatalog(const std::string &directory)
+    {
+        const char *subjects[] = {"Toasters", "Procrastination", "Meetings", "Cats", "Microwave Cooking", "Dad Jokes",
+                                  "Sock Pairing", "Zombies", "Gardening", "Chess"};
+        std::ofstream books(directory + "/books.csv");
+        for (size_t i = 0; i < BOOK_COUNT; ++i)
+        {
+            books << (100000 + i) << ',' << (i % 10 == 0 ? "A Brief History of " : "The Complete Guide to ") << subjects[i % 10]
+                  << ", Volume " << i << ",Author Number " << (i % 500) << ',';
+            if (i % 7 == 0)
+                books << "1,reader" << (i % 50) << ',' << (1700000000 + i) << '\n';
+            else
+                books << "0,,\n";
+        }
+        std::ofstream users(directory + "/users.csv");
+        users << "admin,admin123,0\n";
+    }
+
+    // Runs one search the way the menu does, with the listing closed at once.
+    void search(LibraryManager &library, const std::string &term)
+    {
+        std::istringstream input("\n" + term + "\nq\n");
+        std::ostringstream output;
+        std::streambuf *cin_buffer = std::cin.rdbuf(input.rdbuf());
+        std::streambuf *cout_buffer = std::cout.rdbuf(output.rdbuf());
+        library.searchBookByTitle();
+        std::cin.rdbuf(cin_buffer);
+        std::cout.rdbuf(cout_buffer);
+    }
+
+    bool check(const char *what, double measured, double budget)
+    {
+        bool ok = measured <= budget;
+        std::cout << (ok ? "ok   " : "FAIL ") << what << ": " << measured << " (budget " << budget << ")" << std::endl;
+        return ok;
+    }
+}
+
+int main()
+{
+    if (!AllocStats::enabled())
+    {
+        std::cerr << "AllocBudgetTest must be built with LIBRARY_ALLOC_STATS." << std::endl;
+        return 1;
+    }
+    char directory_template[] = "/tmp/library-alloc-test-XXXXXX";
+    if (mkdtemp(directory_template) == nullptr)
+    {
+        std::cerr << "Could not create a temporary directory." << std::endl;
+        return 1;
+    }
+    const std::string directory = directory_template;
+    writeCatalog(directory);
+
+    bool ok = true;
+    {
+        uint64_t before = allAllocations();
+        LibraryManager library(directory + "/books.csv", directory + "/users.csv", directory + "/holds.csv");
+        double per_row = static_cast<double>(allAllocations() - before) / BOOK_COUNT;
+        ok &= check("allocations per loaded row", per_row, LOAD_ALLOCATIONS_PER_ROW);
+
+        // The first search builds the text index; that is charged to the index, not to searching.
+        search(library, "zombies");
+        const std::initializer_list<AllocStats::Subsystem> searching = {AllocStats::Subsystem::SEARCH, AllocStats::Subsystem::SEARCH_CACHE};
+
+        before = allocations(searching);
+        search(library, "history");
+        ok &= check("allocations per search (2000 matches)", static_cast<double>(allocations(searching) - before), SEARCH_ALLOCATIONS);
+
+        before = allocations(searching);
+        search(library, "volume 1234");
+        ok &= check("allocations per search (all rows match)", static_cast<double>(allocations(searching) - before), SEARCH_ALLOCATIONS);
+
+        before = allocations(searching);
+        search(library, "history");
+        ok &= check("allocations per cached search", static_cast<double>(allocations(searching) - before), CACHED_SEARCH_ALLOCATIONS);
+    }
+
+    std::remove((directory + "/books.csv").c_str());
+    std::remove((directory + "/users.csv").c_str());
+    std::remove((directory + "/holds.csv").c_str());
+    rmdir(directory.c_str());
+    return ok ? 0 : 1;
+}